@@ -0,0 +1,76 @@
+// Double-float (df64) arithmetic: a value is the unevaluated sum hi + lo of two floats, stored as vec2(hi, lo).
+// That gives a ~48 bit mantissa out of plain 32-bit ALU ops, used instead of shaderFloat64 which is slow or
+// missing on consumer GPUs. Every intermediate is precise, the error terms only survive if the compiler neither
+// reassociates nor fuses them into FMAs.
+// Range is still the float range, fine for Mandlebrot where nothing exceeds a few units before escaping.
+
+vec2 df64_from(float a)
+{
+    return vec2(a, 0.0);
+}
+
+// a + b exactly, as sum and rounding error (Knuth)
+vec2 df64_twoSum(float a, float b)
+{
+    precise float s = a + b;
+    precise float v = s - a;
+    precise float e = (a - (s - v)) + (b - v);
+    return vec2(s, e);
+}
+
+// Same as df64_twoSum when |a| >= |b| (Dekker), used to renormalize
+vec2 df64_quickTwoSum(float a, float b)
+{
+    precise float s = a + b;
+    precise float e = b - (s - a);
+    return vec2(s, e);
+}
+
+// Splits a float into two halves of 12 significant bits, their products are exact in float
+vec2 df64_split(float a)
+{
+    const float SPLITTER = 4097.0;      // 2^12 + 1
+    precise float t = a * SPLITTER;
+    precise float hi = t - (t - a);
+    precise float lo = a - hi;
+    return vec2(hi, lo);
+}
+
+// a * b exactly, as product and rounding error. Dekker's split rather than fma(), which isn't guaranteed
+// to be fused on every implementation.
+vec2 df64_twoProd(float a, float b)
+{
+    precise float p = a * b;
+    vec2 aSplit = df64_split(a);
+    vec2 bSplit = df64_split(b);
+    precise float e = ((aSplit.x * bSplit.x - p) + aSplit.x * bSplit.y + aSplit.y * bSplit.x) + aSplit.y * bSplit.y;
+    return vec2(p, e);
+}
+
+vec2 df64_add(vec2 a, vec2 b)
+{
+    precise vec2 s = df64_twoSum(a.x, b.x);
+    precise vec2 t = df64_twoSum(a.y, b.y);
+    s.y += t.x;
+    s = df64_quickTwoSum(s.x, s.y);
+    s.y += t.y;
+    return df64_quickTwoSum(s.x, s.y);
+}
+
+vec2 df64_sub(vec2 a, vec2 b)
+{
+    return df64_add(a, -b);
+}
+
+vec2 df64_mul(vec2 a, vec2 b)
+{
+    precise vec2 p = df64_twoProd(a.x, b.x);
+    p.y += a.x * b.y + a.y * b.x;
+    return df64_quickTwoSum(p.x, p.y);
+}
+
+// Scaling by a power of two is exact, no renormalization needed
+vec2 df64_mul2(vec2 a)
+{
+    return a * 2.0;
+}
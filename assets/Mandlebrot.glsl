@@ -0,0 +1,22 @@
+// Shared by Mandlebrot.comp (rgba8 storage image) and MandlebrotPresent.comp (swapchain image, no format).
+// The including file declares the work group size and the image.
+
+#include "MandlebrotCore.glsl"
+
+void main() {
+
+    /*
+    In order to fit the work into workgroups, some unnecessary threads are launched.
+    We terminate those threads here. 
+    */
+    if(gl_GlobalInvocationID.x >= registers.width || gl_GlobalInvocationID.y >= registers.height)
+        return;
+
+    /*
+    What follows is code for rendering the mandelbrot set. 
+    */
+    float n = ComputeIterations(gl_GlobalInvocationID.xy);
+            
+    // store the rendered mandelbrot set into a storage buffer:
+    imageStore(Image, ivec2(gl_GlobalInvocationID.x, gl_GlobalInvocationID.y), Palette(n));
+}
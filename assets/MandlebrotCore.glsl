@@ -0,0 +1,234 @@
+// Escape time iteration and palette shared by the per pixel kernel (Mandlebrot.glsl) and the Mariani-Silver one
+// (MandlebrotTiles.glsl). The including file declares the work group size and the image.
+
+#include "DF64.glsl"
+
+// Escape loop steps per trip of the outer loop, specialized at pipeline creation (ComputeTask) so the driver
+// can unroll the inner loop completely
+layout(constant_id = 2) const uint UNROLL = 1;
+
+// MandlebrotPrecision: 0 float, 1 double-float, 2 perturbation. ComputeTask builds a pipeline per value and
+// picks one per frame from the zoom depth.
+const uint PRECISION_FLOAT = 0;
+const uint PRECISION_DF64 = 1;
+const uint PRECISION_PERTURBATION = 2;
+layout(constant_id = 3) const uint PRECISION = PRECISION_FLOAT;
+
+// Interior culling for the float and df64 kernels: points in the main cardioid or the period-2 bulb are known to
+// never escape and skip iteration altogether, and orbits which fell into a cycle (Brent's method, checked once per
+// UNROLL steps) stop early. Both count as M iterations. Off, the kernels keep the historic dot(z, z) > 2 escape
+// test, on they use the exact |z| > 2 so a culled pixel gets exactly what iterating it would give. The perturbation
+// kernel only picks up the escape test, deep views hardly ever contain the cardioid.
+layout(constant_id = 4) const bool INTERIOR_CULLING = false;
+
+// View center and the distance between two pixels on the complex plane, as df64 (hi, lo) pairs.
+// The float kernel only reads the hi parts. The perturbation kernel gets the view center relative to the reference
+// orbit's and the step, both hi parts only and in units of 2^deltaExponent, so they don't underflow at deep zooms.
+layout(push_constant) uniform Registers
+{
+    vec2 centerX;
+    vec2 centerY;
+    vec2 step;
+    uint width;
+    uint height;
+    uint maxIterations;
+    int deltaExponent;
+    uint orbitLength;
+    uint tileLevel;         // Mariani-Silver subdivision level, MandlebrotTiles.glsl only
+} registers;
+
+// Z(0) = 0, Z(1) ... of the reference point, computed on the host in high precision (ReferenceOrbitBuilder)
+layout(std430, set = 0, binding = 1) readonly buffer ReferenceOrbit
+{
+    vec2 Z[];
+} orbit;
+
+float EscapeRadiusSquared()
+{
+    return INTERIOR_CULLING ? 4.0 : 2.0;
+}
+
+// Squared distance under which two points of an orbit count as the same, a thousandth of a pixel, but no
+// closer than a few float ulps for the float kernel
+float PeriodicityToleranceSquared()
+{
+    float tolerance = registers.step.x * (1.0 / 1024.0);
+    if (PRECISION == PRECISION_FLOAT)
+        tolerance = max(tolerance, 1.0 / 4194304.0);
+    return tolerance * tolerance;
+}
+
+bool InMainCardioidOrBulb(vec2 c)
+{
+    float xq = c.x - 0.25;
+    float y2 = c.y * c.y;
+    float q = xq*xq + y2;
+    return q * (q + xq) <= 0.25 * y2 || (c.x + 1.0)*(c.x + 1.0) + y2 <= 0.0625;
+}
+
+bool InMainCardioidOrBulbDF64(vec2 cx, vec2 cy)
+{
+    vec2 xq = df64_sub(cx, df64_from(0.25));
+    vec2 y2 = df64_mul(cy, cy);
+    vec2 q = df64_add(df64_mul(xq, xq), y2);
+    bool cardioid = df64_sub(df64_mul(q, df64_add(q, xq)), y2 * 0.25).x <= 0.0;
+    vec2 xb = df64_add(cx, df64_from(1.0));
+    bool bulb = df64_sub(df64_add(df64_mul(xb, xb), y2), df64_from(0.0625)).x <= 0.0;
+    return cardioid || bulb;
+}
+
+// Both return the number of iterations before z escaped, M when it never did
+float IterateFloat(vec2 offset, uint M)
+{
+    vec2 c = vec2(registers.centerX.x, registers.centerY.x) + offset * registers.step.x;
+    if (INTERIOR_CULLING && InMainCardioidOrBulb(c))
+        return float(M);
+
+    vec2 z = vec2(0.0);
+    float n = 0.0;
+    bool escaped = false;
+    // Brent: compare against the z saved at the last power of two trip count
+    vec2 saved = z;
+    uint tripsSinceSave = 0;
+    uint saveInterval = 1;
+    for (uint i = 0; i<M && !escaped; i += UNROLL)
+    {
+        for (uint u = 0; u < UNROLL; u++)
+        {
+            z = vec2(z.x*z.x - z.y*z.y, 2.*z.x*z.y) + c;
+            if (dot(z, z) > EscapeRadiusSquared()) { escaped = true; break; }
+            n++;
+        }
+
+        if (INTERIOR_CULLING && !escaped)
+        {
+            vec2 d = z - saved;
+            if (dot(d, d) < PeriodicityToleranceSquared())
+                return float(M);
+            if (++tripsSinceSave == saveInterval)
+            {
+                saved = z;
+                tripsSinceSave = 0;
+                saveInterval *= 2;
+            }
+        }
+    }
+    return n;
+}
+
+float IterateDF64(vec2 offset, uint M)
+{
+    // offset is a small integer (or half of one), exact in a float
+    vec2 cx = df64_add(registers.centerX, df64_mul(df64_from(offset.x), registers.step));
+    vec2 cy = df64_add(registers.centerY, df64_mul(df64_from(offset.y), registers.step));
+    if (INTERIOR_CULLING && InMainCardioidOrBulbDF64(cx, cy))
+        return float(M);
+
+    vec2 zx = vec2(0.0);
+    vec2 zy = vec2(0.0);
+    float n = 0.0;
+    bool escaped = false;
+    vec2 savedX = zx;
+    vec2 savedY = zy;
+    uint tripsSinceSave = 0;
+    uint saveInterval = 1;
+    for (uint i = 0; i<M && !escaped; i += UNROLL)
+    {
+        for (uint u = 0; u < UNROLL; u++)
+        {
+            vec2 zx2 = df64_mul(zx, zx);
+            vec2 zy2 = df64_mul(zy, zy);
+            zy = df64_add(df64_mul2(df64_mul(zx, zy)), cy);
+            zx = df64_add(df64_sub(zx2, zy2), cx);
+            // The escape test doesn't need the low parts
+            if (zx.x*zx.x + zy.x*zy.x > EscapeRadiusSquared()) { escaped = true; break; }
+            n++;
+        }
+
+        if (INTERIOR_CULLING && !escaped)
+        {
+            vec2 d = vec2(df64_sub(zx, savedX).x, df64_sub(zy, savedY).x);
+            if (dot(d, d) < PeriodicityToleranceSquared())
+                return float(M);
+            if (++tripsSinceSave == saveInterval)
+            {
+                savedX = zx;
+                savedY = zy;
+                tripsSinceSave = 0;
+                saveInterval *= 2;
+            }
+        }
+    }
+    return n;
+}
+
+// Iterates the difference dz to the reference orbit: z = Z(m) + dz, dz' = 2 Z(m) dz + dz^2 + dc.
+// dz and dc are kept as w * 2^e so they survive zooms far below the float range, e starts at deltaExponent and is
+// raised as dz grows. Whenever |z| < |dz| the reference can't represent the pixel's orbit any more (the classic
+// perturbation glitch), and once the reference escaped there is nothing left to follow: in both cases the pixel is
+// rebased onto Z(0) = 0 with dz = z, after which it keeps following the same reference from its start.
+float IteratePerturbation(vec2 offset, uint M)
+{
+    int e = registers.deltaExponent;
+    vec2 dc = vec2(registers.centerX.x, registers.centerY.x) + offset * registers.step.x;
+    vec2 w = vec2(0.0);
+    uint m = 0;
+    float n = 0.0;
+    for (uint i = 0; i < M; i++)
+    {
+        vec2 Z = orbit.Z[m];
+        vec2 zw = vec2(Z.x*w.x - Z.y*w.y, Z.x*w.y + Z.y*w.x);
+        vec2 ww = vec2(w.x*w.x - w.y*w.y, 2.*w.x*w.y);
+        w = 2.*zw + ldexp(ww, ivec2(e)) + dc;
+        m++;
+
+        // dz underflows to zero while it's far below the reference's ulps, where it can't matter for z
+        vec2 dz = ldexp(w, ivec2(e));
+        vec2 z = orbit.Z[m] + dz;
+        if (dot(z, z) > EscapeRadiusSquared())
+            break;
+        n++;
+
+        if (dot(z, z) < dot(dz, dz) || m + 1 >= registers.orbitLength)
+        {
+            w = ldexp(z, ivec2(-e));
+            m = 0;
+        }
+
+        // Keep w^2 far from overflowing, dc shrinks along and only underflows once it's negligible next to dz
+        if (e < 0 && max(abs(w.x), abs(w.y)) > 65536.0)
+        {
+            int shift = min(16, -e);
+            w = ldexp(w, ivec2(-shift));
+            dc = ldexp(dc, ivec2(-shift));
+            e += shift;
+        }
+    }
+    return n;
+}
+
+// Iterations before the pixel's orbit escaped, M when it never did
+float ComputeIterations(uvec2 pixel)
+{
+    // Pixel offset from the image center, the host scales the step by the shorter side so non square targets
+    // (swapchain images) aren't stretched
+    vec2 offset = vec2(pixel) - 0.5 * vec2(registers.width, registers.height);
+
+    uint M = registers.maxIterations;
+    float n = PRECISION == PRECISION_PERTURBATION ? IteratePerturbation(offset, M) :
+        (PRECISION == PRECISION_DF64 ? IterateDF64(offset, M) : IterateFloat(offset, M));
+    // The last trip can run past M when UNROLL doesn't divide it, same result as stopping at M
+    return min(n, float(M));
+}
+
+vec4 Palette(float n)
+{
+    // we use a simple cosine palette to determine color:
+    // http://iquilezles.org/www/articles/palettes/palettes.htm         
+    float t = float(n) / float(registers.maxIterations);
+    vec3 d = vec3(0.3, 0.3 ,0.5);
+    vec3 e = vec3(-0.2, -0.3 ,-0.5);
+    vec3 f = vec3(2.1, 2.0, 3.0);
+    vec3 g = vec3(0.0, 0.1, 0.0);
+    return vec4( d + e*cos( 6.28318*(f*t+g) ) ,1.0);
+}
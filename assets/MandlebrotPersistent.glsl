@@ -0,0 +1,39 @@
+// Persistent threads, shared by MandlebrotPersistent.comp (rgba8 storage image) and MandlebrotPersistentPresent.comp
+// (swapchain image, no format). The including file declares the work group size and the image.
+//
+// Instead of one workgroup per tile, ComputeTask launches about as many workgroups as the device keeps resident and
+// every one of them pulls tiles (one pixel per invocation) from a global counter until the image is done. A workgroup
+// stuck on a slow boundary tile no longer holds back a whole wave, the others keep draining the queue.
+
+#include "MandlebrotCore.glsl"
+
+// Next tile to hand out, zeroed by ComputeTask before the dispatch
+layout(std430, set = 1, binding = 0) buffer TileQueue
+{
+    uint nextTile;
+} queue;
+
+shared uint currentTile;
+
+void main()
+{
+    uvec2 tiles = (uvec2(registers.width, registers.height) + gl_WorkGroupSize.xy - 1) / gl_WorkGroupSize.xy;
+    uint tileCount = tiles.x * tiles.y;
+
+    for (;;)
+    {
+        if (gl_LocalInvocationIndex == 0)
+            currentTile = atomicAdd(queue.nextTile, 1u);
+        barrier();
+        uint tile = currentTile;
+        // Everyone has read it before invocation 0 pulls the next one
+        barrier();
+
+        if (tile >= tileCount)
+            break;
+
+        uvec2 pixel = uvec2(tile % tiles.x, tile / tiles.x) * gl_WorkGroupSize.xy + gl_LocalInvocationID.xy;
+        if (pixel.x < registers.width && pixel.y < registers.height)
+            imageStore(Image, ivec2(pixel), Palette(ComputeIterations(pixel)));
+    }
+}
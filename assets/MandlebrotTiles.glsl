@@ -0,0 +1,148 @@
+// Mariani-Silver rendering, shared by MandlebrotTiles.comp (rgba8 storage image) and MandlebrotTilesPresent.comp
+// (swapchain image, no format). The including file declares the image.
+//
+// The image is cut into TILE_SIZE tiles, one workgroup each. A workgroup iterates the border of its tile only. When
+// every border pixel got the same count the inside gets it too (the set is connected, so nothing can hide inside a
+// uniform border) and is filled without iterating. Otherwise the tile is split in four and the quarters are appended
+// to the next level's list, which ComputeTask dispatches with vkCmdDispatchIndirect: the work list and the dispatch
+// size never leave the GPU. Tiles of the last level, or ones that don't fit the list, iterate their inside.
+
+#include "MandlebrotCore.glsl"
+
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// Mirrored in ComputeTask.h
+const uint TILE_LEVELS = 3;
+const uint TILE_SIZE = 64;                  // level 0, halved every level
+const uint TILE_LIST_CAPACITY = 65535;      // entries per level, also the largest dispatch the spec guarantees
+
+struct DispatchIndirect
+{
+    uint x;                 // VkDispatchIndirectCommand
+    uint y;
+    uint z;
+    uint allocated;         // list entries handed out, x only counts the ones which fit
+};
+
+layout(std430, set = 1, binding = 0) buffer TileControl
+{
+    DispatchIndirect dispatches[TILE_LEVELS];   // [0] is unused, level 0 is a direct dispatch over the image
+    uint iteratedPixels;                        // for the benchmark, pixels iterated (border ones once per level)
+} control;
+
+// Level l's tiles start at (l - 1) * TILE_LIST_CAPACITY, origin x | y << 16
+layout(std430, set = 1, binding = 1) buffer TileLists
+{
+    uint tiles[];
+} lists;
+
+shared uint borderMin;
+shared uint borderMax;
+shared bool subdivided;
+
+// Walks the border of a size.x * size.y tile (both at least 3): top row, bottom row, left and right columns
+uvec2 BorderPixel(uint k, uvec2 size)
+{
+    if (k < size.x)
+        return uvec2(k, 0);
+    k -= size.x;
+    if (k < size.x)
+        return uvec2(k, size.y - 1);
+    k -= size.x;
+    if (k < size.y - 2)
+        return uvec2(0, k + 1);
+    return uvec2(size.x - 1, k - (size.y - 2) + 1);
+}
+
+// Appends the quarters of the tile which overlap the image to the next level, all or none
+bool Subdivide(uvec2 origin, uint tileSize, uint level)
+{
+    uvec2 imageSize = uvec2(registers.width, registers.height);
+    uint halfSize = tileSize / 2;
+    uvec2 quarters[4] = uvec2[](origin, origin + uvec2(halfSize, 0), origin + uvec2(0, halfSize), origin + uvec2(halfSize, halfSize));
+
+    uint count = 0;
+    for (uint q = 0; q < 4; q++)
+        count += all(lessThan(quarters[q], imageSize)) ? 1u : 0u;
+
+    uint base = atomicAdd(control.dispatches[level + 1].allocated, count);
+    if (base + count > TILE_LIST_CAPACITY)
+        return false;
+
+    uint entry = (level * TILE_LIST_CAPACITY) + base;
+    for (uint q = 0; q < 4; q++)
+    {
+        if (all(lessThan(quarters[q], imageSize)))
+            lists.tiles[entry++] = quarters[q].x | (quarters[q].y << 16);
+    }
+    // Allocations are handed out in order, once one fails every later one does: the valid entries are contiguous
+    atomicMax(control.dispatches[level + 1].x, base + count);
+    return true;
+}
+
+void main()
+{
+    uint level = registers.tileLevel;
+    uint tileSize = TILE_SIZE >> level;
+
+    uvec2 origin = gl_WorkGroupID.xy * TILE_SIZE;
+    if (level > 0)
+    {
+        uint tile = lists.tiles[(level - 1) * TILE_LIST_CAPACITY + gl_WorkGroupID.x];
+        origin = uvec2(tile & 0xFFFF, tile >> 16);
+    }
+
+    // Tiles on the right and bottom edges are clipped, the ones thinner than 3 pixels are all border
+    uvec2 size = min(uvec2(tileSize), uvec2(registers.width, registers.height) - origin);
+    bool thin = size.x < 3 || size.y < 3;
+    uint borderCount = thin ? size.x * size.y : 2 * (size.x + size.y) - 4;
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+        borderMin = 0xFFFFFFFF;
+        borderMax = 0;
+    }
+    barrier();
+
+    for (uint k = gl_LocalInvocationIndex; k < borderCount; k += gl_WorkGroupSize.x)
+    {
+        uvec2 pixel = origin + (thin ? uvec2(k % size.x, k / size.x) : BorderPixel(k, size));
+        float n = ComputeIterations(pixel);
+        imageStore(Image, ivec2(pixel), Palette(n));
+        atomicMin(borderMin, uint(n));
+        atomicMax(borderMax, uint(n));
+    }
+    barrier();
+
+    uint iterated = borderCount;
+    if (!thin)
+    {
+        uvec2 inside = size - 2;
+        uint insideCount = inside.x * inside.y;
+        if (borderMin == borderMax)
+        {
+            vec4 color = Palette(float(borderMin));
+            for (uint k = gl_LocalInvocationIndex; k < insideCount; k += gl_WorkGroupSize.x)
+                imageStore(Image, ivec2(origin + 1 + uvec2(k % inside.x, k / inside.x)), color);
+        }
+        else
+        {
+            if (gl_LocalInvocationIndex == 0)
+                subdivided = level + 1 < TILE_LEVELS && Subdivide(origin, tileSize, level);
+            barrier();
+
+            if (!subdivided)
+            {
+                for (uint k = gl_LocalInvocationIndex; k < insideCount; k += gl_WorkGroupSize.x)
+                {
+                    uvec2 pixel = origin + 1 + uvec2(k % inside.x, k / inside.x);
+                    imageStore(Image, ivec2(pixel), Palette(ComputeIterations(pixel)));
+                }
+                iterated += insideCount;
+            }
+        }
+    }
+
+    if (gl_LocalInvocationIndex == 0)
+        atomicAdd(control.iteratedPixels, iterated);
+}
@@ -0,0 +1,44 @@
+# Turns a SPIR-V binary into a header holding it as a constexpr uint32_t array.
+# Run in script mode:
+#   cmake -DSPV_FILE=<in.spv> -DVAR_NAME=<name> -DOUTPUT=<out.h> -P EmbedSpirv.cmake
+
+file(READ ${SPV_FILE} SPV_HEX HEX)
+string(LENGTH "${SPV_HEX}" SPV_HEX_LENGTH)
+math(EXPR SPV_WORD_REMAINDER "${SPV_HEX_LENGTH} % 8")
+if(NOT SPV_WORD_REMAINDER EQUAL 0 OR SPV_HEX_LENGTH EQUAL 0)
+    message(FATAL_ERROR "${SPV_FILE} is not a valid SPIR-V binary")
+endif()
+
+# SPIR-V is a stream of little endian words, swap every group of 4 bytes into a uint32_t literal
+string(REGEX MATCHALL "........" SPV_WORDS "${SPV_HEX}")
+set(WORD_LIST "")
+set(WORDS_ON_LINE 0)
+foreach(WORD ${SPV_WORDS})
+    string(SUBSTRING ${WORD} 0 2 B0)
+    string(SUBSTRING ${WORD} 2 2 B1)
+    string(SUBSTRING ${WORD} 4 2 B2)
+    string(SUBSTRING ${WORD} 6 2 B3)
+    string(APPEND WORD_LIST "0x${B3}${B2}${B1}${B0}u,")
+    math(EXPR WORDS_ON_LINE "${WORDS_ON_LINE} + 1")
+    if(WORDS_ON_LINE EQUAL 8)
+        string(APPEND WORD_LIST "\n        ")
+        set(WORDS_ON_LINE 0)
+    else()
+        string(APPEND WORD_LIST " ")
+    endif()
+endforeach()
+string(STRIP "${WORD_LIST}" WORD_LIST)
+
+file(WRITE ${OUTPUT}
+"// Generated from ${SPV_FILE}, do not edit
+#pragma once
+#include <cstdint>
+
+namespace EmbeddedShaders
+{
+    constexpr uint32_t ${VAR_NAME}[] =
+    {
+        ${WORD_LIST}
+    };
+}
+")
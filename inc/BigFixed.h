@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Signed fixed point number with a 32-bit integer part and (limbCount - 1) * 32 fractional bits, for the
+// perturbation reference orbit. Sign and magnitude, the magnitude is stored most significant limb first
+// (limb 0 is the integer part). Plenty for Mandlebrot, where nothing exceeds a few units before escaping.
+// Operands of a binary operation need the same limb count.
+class BigFixed
+{
+private:
+    bool m_negative = false;
+    std::vector<uint32_t> m_limbs;
+
+    bool IsZero() const;
+    // Compares magnitudes, ignoring the sign
+    int CompareMagnitude(const BigFixed& other) const;
+    // Magnitude a + b and a - b (|a| >= |b|)
+    static void AddMagnitude(const BigFixed& a, const BigFixed& b, BigFixed& result);
+    static void SubtractMagnitude(const BigFixed& a, const BigFixed& b, BigFixed& result);
+
+    void AddSmall(uint32_t value);
+    void DivideSmall(uint32_t divisor);
+
+public:
+    explicit BigFixed(uint32_t limbCount = 2);
+
+    static BigFixed FromDouble(double value, uint32_t limbCount);
+    // Decimal notation ("-0.7436438870371587047522"), as many digits as the limbs can hold. False on bad input.
+    static bool Parse(const std::string& text, uint32_t limbCount, BigFixed& result);
+
+    double ToDouble() const;
+    uint32_t GetLimbCount() const;
+    // Same value, truncated or zero extended to limbCount
+    BigFixed WithLimbCount(uint32_t limbCount) const;
+
+    BigFixed operator+(const BigFixed& other) const;
+    BigFixed operator-(const BigFixed& other) const;
+    BigFixed operator*(const BigFixed& other) const;
+    BigFixed operator-() const;
+    // Times two, exact
+    BigFixed Twice() const;
+
+    bool operator==(const BigFixed& other) const;
+    bool operator!=(const BigFixed& other) const;
+};
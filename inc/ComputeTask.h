@@ -0,0 +1,264 @@
+#pragma once
+#include "Utils.h"
+#include "ReferenceOrbit.h"
+#include <array>
+#include <memory>
+
+class CpuMandlebrot;
+class ReadbackRing;
+
+// Arithmetic the escape loop runs in, specialization constant 3 of Mandlebrot.comp
+enum class MandlebrotPrecision : uint32_t
+{
+    FLOAT,      // 32-bit float, pixelates once neighbouring pixels are a few float ulps apart
+    DF64,       // float pairs, ~48 bit mantissa, several times slower per iteration
+    PERTURBATION,   // float differences to a high precision reference orbit, any depth
+    AUTO,       // picked every frame from the zoom depth, see ComputeTask::SelectPrecision
+};
+
+// How the work is spread over workgroups
+enum class MandlebrotKernel : uint32_t
+{
+    GRID,           // Mandlebrot.comp, one workgroup per tile over the whole image
+    PERSISTENT,     // MandlebrotPersistent.comp, resident workgroups pull tiles from an atomic counter
+    MARIANI_SILVER, // MandlebrotTiles.comp, border tracing with GPU driven subdivision
+};
+
+// Kernel parameters which used to be hard-coded in Mandlebrot.comp
+struct MandlebrotSettings
+{
+    uint32_t workgroupSizeX = 32;
+    uint32_t workgroupSizeY = 32;
+    uint32_t maxIterations = 128;
+    uint32_t unroll = 1;            // escape loop unroll factor, specialization constant 2
+    MandlebrotPrecision precision = MandlebrotPrecision::AUTO;
+    bool interiorCulling = false;   // cardioid / bulb test and cycle detection, specialization constant 4
+    MandlebrotKernel kernel = MandlebrotKernel::GRID;
+    uint32_t persistentWorkgroups = 0;  // workgroups the PERSISTENT kernel launches, 0 picks one from the workgroup size
+    // The CPU renders a band of rows next to the GPU, see ComputeTask::SelectGpuRows. GRID kernel into the task's
+    // storage images only, frames which need more than float precision stay on the GPU.
+    bool hybridCpu = false;
+    uint32_t cpuThreads = 0;        // CpuMandlebrot workers for hybridCpu, 0 uses every hardware thread
+};
+
+// Region of the complex plane to render. In double so deep zooms survive until the df64 kernel.
+struct MandlebrotView
+{
+    double centerX = -0.445;
+    double centerY = 0.0;
+    double zoom = 1.0;              // 1.0 shows the whole set, smaller zooms in
+    // Decimal center with more digits than a double holds, used by the perturbation kernel instead of
+    // centerX / centerY when set. Past ~1e-13 zoom a double can't place the center between two pixels.
+    std::string preciseCenterX;
+    std::string preciseCenterY;
+};
+
+class ComputeTask
+{
+private:
+    const VkQueue& m_computeQueue;
+    const VkDevice& m_device;
+    MemoryAllocator& m_allocator;
+    GpuProfiler& m_profiler;
+
+    VkCommandPool m_commandPool;
+    std::vector<VkCommandBuffer> m_commandBuffers;
+
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_descriptorSets;
+
+    // One pipeline per precision, indexed by MandlebrotPrecision. Only the ones settings.precision can pick get built.
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    std::array<VkPipeline, 3> m_pipelines{};
+    VkShaderModule m_shaderModule = VK_NULL_HANDLE;
+
+    // Zero-copy present, see EnableSwapchainTargets. One descriptor set per frame in flight, pointed at the
+    // acquired swapchain image each frame (the host already waited for the previous use of the set).
+    std::array<VkPipeline, 3> m_presentPipelines{};
+    VkShaderModule m_presentShaderModule = VK_NULL_HANDLE;
+    VkDescriptorPool m_presentDescriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_presentDescriptorSets;
+
+    // One storage image per frame in flight, so the dispatch of frame N+1 never touches the image frame N is still reading
+    std::vector<VkImage> m_storageImages;
+    std::vector<MemoryAllocation> m_storageImageMemory;
+    std::vector<VkImageView> m_storageImageViews;
+
+    // The storage images are released to m_releaseQueueFamily after every dispatch when the sampling side lives in
+    // another family. The next dispatch takes them back without a transfer, it overwrites every pixel anyway.
+    uint32_t m_queueFamilyIndex;
+    uint32_t m_releaseQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+
+    uint32_t m_imageWidth;
+    uint32_t m_imageHeight;
+    uint32_t m_maxFrameInFlights;
+    MandlebrotSettings m_settings;
+
+    // Perturbation: reference orbit per frame in flight (binding 1), rewritten when a newer orbit is done. Bound
+    // for every precision, the kernels share one shader. m_referenceOrbits only exists when perturbation can be picked.
+    std::unique_ptr<ReferenceOrbitBuilder> m_referenceOrbits;
+    std::vector<VkBuffer> m_orbitBuffers;
+    std::vector<MemoryAllocation> m_orbitBufferMemory;
+    std::vector<uint64_t> m_orbitBufferVersions;
+
+    MandlebrotPrecision m_lastPrecision = MandlebrotPrecision::FLOAT;
+
+    // Set 1, the PERSISTENT and MARIANI_SILVER kernels' scheduling state, one per frame in flight. The control buffer
+    // is the tile counter of MandlebrotPersistent.glsl or the TileControl of MandlebrotTiles.glsl (mirrored below),
+    // the list buffer holds the tiles Mariani-Silver levels hand to each other. Both stay device local, the stats
+    // buffer gets Mariani-Silver's iteratedPixels copied into host memory at the end of the frame.
+    static constexpr uint32_t TILE_LEVELS = 3;
+    static constexpr uint32_t TILE_SIZE = 64;
+    static constexpr uint32_t TILE_LIST_CAPACITY = 65535;
+
+    struct TileDispatch
+    {
+        VkDispatchIndirectCommand command;
+        uint32_t allocated;
+    };
+    struct TileControl
+    {
+        TileDispatch dispatches[TILE_LEVELS];
+        uint32_t iteratedPixels;
+    };
+
+    VkDescriptorSetLayout m_tileDescriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_tileDescriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_tileDescriptorSets;
+    std::vector<VkBuffer> m_tileControlBuffers;
+    std::vector<MemoryAllocation> m_tileControlMemory;
+    std::vector<VkBuffer> m_tileListBuffers;
+    std::vector<MemoryAllocation> m_tileListMemory;
+    std::vector<VkBuffer> m_tileStatsBuffers;
+    std::vector<MemoryAllocation> m_tileStatsMemory;
+    std::vector<uint32_t> m_tilePixelCounts;    // width * height of each frame in flight's last dispatch
+    uint32_t m_persistentWorkgroups = 0;
+
+    // Hybrid rendering: the GPU dispatch covers the top rows, the CPU renders the rest into the frame in flight's
+    // staging buffer meanwhile and a second submission copies them into the storage image. Rows per millisecond of
+    // both sides are measured every frame (GPU timestamps, CPU wall time) and decide the next split.
+    std::unique_ptr<CpuMandlebrot> m_cpuRenderer;
+    std::vector<VkCommandBuffer> m_uploadCommandBuffers;
+    std::vector<VkBuffer> m_stagingBuffers;
+    std::vector<MemoryAllocation> m_stagingBufferMemory;
+    struct HybridSplit
+    {
+        uint32_t gpuRows = 0;
+        uint32_t cpuRows = 0;
+        double cpuMs = 0.0;
+    };
+    std::vector<HybridSplit> m_hybridSplits;    // what each frame in flight's last frame did
+    double m_gpuRowsPerMs = 0.0;
+    double m_cpuRowsPerMs = 0.0;
+    uint32_t m_lastGpuRows = 0;
+
+    // Copies every storage image frame to the host when set, see SetReadbackRing
+    ReadbackRing* m_readbackRing = nullptr;
+
+    // Matches the push constant block of Mandlebrot.comp, the doubles are split into (hi, lo) float pairs
+    struct PushConstants
+    {
+        float centerX[2];
+        float centerY[2];
+        float step[2];
+        uint32_t width;
+        uint32_t height;
+        uint32_t maxIterations;
+        int32_t deltaExponent;
+        uint32_t orbitLength;
+        uint32_t tileLevel;
+    };
+
+    // swapchainImage is VK_NULL_HANDLE when dispatching into the task's own storage image
+    struct DispatchTarget
+    {
+        VkPipeline pipeline;
+        VkDescriptorSet descriptorSet;
+        VkImage swapchainImage;
+    };
+
+    // Creates the shader module and a pipeline for every precision settings.precision allows
+    void CreatePipelines(const VkPipelineCache& pipelineCache, const uint32_t* code, size_t codeSize,
+        VkShaderModule& shaderModule, std::array<VkPipeline, 3>& pipelines);
+    VkPipeline CreatePipeline(const VkPipelineCache& pipelineCache, const VkShaderModule& shaderModule, MandlebrotPrecision precision);
+    void CreateOrbitBuffers();
+    void CreateTileResources();
+    // Zeroes the frame's tile counter and records the fixed size dispatch
+    void RecordPersistentDispatch(const uint32_t& frameInFlight, const PushConstants& pushConstants);
+    // Resets the frame's tile control buffer and records every subdivision level
+    void RecordTileDispatches(const uint32_t& frameInFlight, const PushConstants& pushConstants);
+    void WriteOrbitDescriptors(const std::vector<VkDescriptorSet>& descriptorSets);
+    // Brings the frame in flight's orbit buffer up to date and fills the perturbation push constants
+    void PrepareReferenceOrbit(const MandlebrotView& view, uint32_t frameInFlight, double step, PushConstants& pushConstants);
+
+    // Picks the precision for the frame and fills the push constants for a width x height target
+    MandlebrotPrecision PreparePushConstants(const MandlebrotView& view, uint32_t frameInFlight, uint32_t width, uint32_t height,
+        PushConstants& pushConstants);
+    // Dispatches over the first gpuRows rows of the target, all of them unless hybrid rendering split the frame
+    void BuildCommandBuffers(const uint32_t& frameInFlight, const DispatchTarget& target, const PushConstants& pushConstants,
+        uint32_t gpuRows);
+    // Readback copy (when there is a ring) and queue family release of the finished storage image, srcStageMask /
+    // srcAccessMask are its last writes
+    void RecordStorageImageEpilogue(const VkCommandBuffer& commandBuffer, const uint32_t& frameInFlight,
+        VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask);
+    void RecordStorageImageRelease(const VkCommandBuffer& commandBuffer, const uint32_t& frameInFlight,
+        VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask);
+    void Submit(const VkCommandBuffer& commandBuffer, const VkSemaphoreSubmitInfo* waitInfo, const VkSemaphoreSubmitInfo* signalInfo);
+
+    void CreateHybridResources();
+    // Rows the GPU takes this frame, a multiple of the workgroup height, from the throughput both sides measured
+    uint32_t SelectGpuRows(const uint32_t& frameInFlight);
+    // Renders rows [gpuRows, height) on the CPU and records their copy into the storage image
+    void RenderCpuRows(const uint32_t& frameInFlight, const MandlebrotView& view, uint32_t gpuRows);
+
+public:
+
+    // The storage image transitions are recorded into immediateContext's open batch, submitting it is up to the caller
+    ComputeTask(const VkDevice& device, MemoryAllocator& allocator, const VkPipelineCache& pipelineCache, GpuProfiler& profiler,
+        ImmediateSubmitContext& immediateContext, const VkQueue& computeQueue, uint32_t queueFamilyIndex, uint32_t maxFrameInFlight, uint32_t imageWidth, uint32_t imageHeight,
+        const MandlebrotSettings& settings = MandlebrotSettings{});
+    ~ComputeTask();
+
+    // Dispatches Mandlebrot.comp and signals signalValue (COMPUTE_FINISHED) on the frame's timeline semaphore
+    void Update(const uint32_t& frameIndex, const uint32_t& frameInFlight,
+        const VkSemaphore& timelineSem, uint64_t signalValue, const MandlebrotView& view);
+
+    // Creates the MandlebrotPresent pipeline, which writes swapchain images directly. Needs swapchain images with
+    // storage usage and shaderStorageImageWriteWithoutFormat, see VulkanManager::IsStoragePresentSupported().
+    void EnableSwapchainTargets(const VkPipelineCache& pipelineCache);
+
+    // Dispatches into the acquired swapchain image (waiting for imageAcquiredSemaphore) and leaves it in
+    // PRESENT_SRC, signalValue (COMPUTE_FINISHED) then means the image is ready to be presented
+    void UpdateSwapchainTarget(const uint32_t& frameInFlight,
+        const VkImage& image, const VkImageView& imageView, const VkExtent2D& extent, const VkSemaphore& imageAcquiredSemaphore,
+        const VkSemaphore& timelineSem, uint64_t signalValue, const MandlebrotView& view);
+
+    // Distance between two pixels on the complex plane, the view spans zoom * 2.34 over the shorter side
+    static double GetPixelStep(const MandlebrotView& view, uint32_t width, uint32_t height);
+    // FLOAT while a pixel still spans enough float ulps of the view center, then DF64, then PERTURBATION
+    static MandlebrotPrecision SelectPrecision(const MandlebrotView& view, uint32_t width, uint32_t height);
+    // Precision of the last dispatch
+    MandlebrotPrecision GetLastPrecision() const;
+    static const char* GetPrecisionName(MandlebrotPrecision precision);
+    static const char* GetKernelName(MandlebrotKernel kernel);
+    // "grid", "persistent", "mariani-silver"
+    static bool ParseKernel(const std::string& name, MandlebrotKernel& kernel);
+    // Update copies each frame into the frame in flight's buffer of readbackRing (sized like the storage images),
+    // nullptr stops it. Swapchain targets aren't read back.
+    void SetReadbackRing(ReadbackRing* readbackRing);
+    // Share of the rows the GPU rendered in the last hybrid frame, 1.0 without hybrid rendering
+    double GetGpuRowShare() const;
+    // Pixels the frame in flight's last Mariani-Silver dispatch iterated over the pixel count, 1.0 without it.
+    // Only meaningful once that dispatch completed.
+    double GetIteratedPixelFraction(uint32_t frameInFlight) const;
+
+    // Family the storage images are sampled on, a release barrier is recorded when it differs from the compute family
+    void SetReleaseQueueFamily(uint32_t queueFamilyIndex);
+    // Whether the graphics side has to record the matching acquire
+    bool IsReleasingStorageImages() const;
+    uint32_t GetQueueFamilyIndex() const;
+
+    const std::vector<VkImage>& GetStorageImages();
+    const std::vector<VkImageView>& GetStorageImageViews();
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include "WorkStealingPool.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MandlebrotView;
+struct MandlebrotSettings;
+
+// The float kernel's push constants (hi parts of ComputeTask::PushConstants) plus its interior culling switch
+struct CpuMandlebrotParams
+{
+    float centerX = -0.445f;
+    float centerY = 0.0f;
+    float step = 0.0f;              // distance between two pixels on the complex plane
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t maxIterations = 128;
+    bool interiorCulling = false;   // cardioid / bulb test and the exact escape radius, no cycle detection
+
+    static CpuMandlebrotParams FromView(const MandlebrotView& view, uint32_t width, uint32_t height, const MandlebrotSettings& settings);
+};
+
+// Widest vector instruction set the escape loop runs with
+enum class CpuSimdLevel : uint32_t
+{
+    SCALAR,
+    SSE2,       // 4 pixels per vector
+    AVX2,       // 8
+    AVX512,     // 16
+};
+
+// CPU renderer producing the image of Mandlebrot.comp's float kernel (same mapping, escape test and palette), as a
+// fallback without a Vulkan device and a reference to check the GPU against. Vectorized across the pixels of a
+// row with per lane escape masks, the instruction set is picked from CPUID. Tiles are spread over every core by a
+// WorkStealingPool.
+class CpuMandlebrot
+{
+private:
+    CpuMandlebrot(CpuMandlebrot const&) = delete;
+    CpuMandlebrot const& operator= (CpuMandlebrot const&) = delete;
+
+    using IterateRowFunction = void(*)(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations);
+
+    WorkStealingPool m_pool;
+    CpuSimdLevel m_simdLevel;
+    IterateRowFunction m_iterateRow;
+
+    // RGBA8 color of every iteration count, n is a whole number in [0, maxIterations]
+    std::vector<uint32_t> m_palette;
+    uint32_t m_paletteMaxIterations = 0;
+
+    void BuildPalette(uint32_t maxIterations);
+
+public:
+    // threadCount 0 uses every hardware thread, maxSimdLevel caps what CPUID reports
+    explicit CpuMandlebrot(uint32_t threadCount = 0, CpuSimdLevel maxSimdLevel = CpuSimdLevel::AVX512);
+
+    // Renders params.width x params.height pixels into pixels, RGBA8 rows without padding like the storage image
+    void Render(const CpuMandlebrotParams& params, uint32_t* pixels);
+    // Only rows [firstRow, firstRow + rowCount), pixels points at the first of them
+    void Render(const CpuMandlebrotParams& params, uint32_t firstRow, uint32_t rowCount, uint32_t* pixels);
+    // Iteration counts instead of colors, one float per pixel
+    void RenderIterations(const CpuMandlebrotParams& params, float* iterations);
+    // Scalar long double iteration of the view (preciseCenterX / Y when set), slow but independent of the df64 and
+    // perturbation kernels' tricks: the reference the regression suite checks them against. Same mapping, escape
+    // test and palette as Render. False when a long double can't resolve the pixels, long double is only a double
+    // with MSVC, the x87 format elsewhere on x86-64 goes ~1000x deeper.
+    bool RenderPrecise(const MandlebrotView& view, uint32_t width, uint32_t height, const MandlebrotSettings& settings, uint32_t* pixels);
+
+    CpuSimdLevel GetSimdLevel() const;
+    uint32_t GetThreadCount() const;
+
+    static CpuSimdLevel DetectSimdLevel();
+    static const char* GetSimdLevelName(CpuSimdLevel level);
+    // "scalar", "sse2", "avx2", "avx512"
+    static bool ParseSimdLevel(const std::string& name, CpuSimdLevel& level);
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include "CpuMandlebrot.h"
+
+// Escape time loop of CpuMandlebrot, written once against a small vector interface (Ops) and instantiated by every
+// kernel source with its own instruction set flags. Everything below stays in an anonymous namespace and avoids the
+// standard library: an inline function shared between the sources could otherwise be merged by the linker into
+// its AVX-512 copy and run on a CPU without AVX-512.
+
+// Iteration counts of the count pixels of row y starting at column x
+void IterateRowScalar(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations);
+void IterateRowSse2(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations);
+void IterateRowAvx2(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations);
+void IterateRowAvx512(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations);
+
+namespace
+{
+    // Same test as InMainCardioidOrBulb in MandlebrotCore.glsl
+    template<typename Ops>
+    typename Ops::Mask InMainCardioidOrBulb(typename Ops::Vec cx, typename Ops::Vec cy)
+    {
+        typename Ops::Vec xq = Ops::Sub(cx, Ops::Set(0.25f));
+        typename Ops::Vec y2 = Ops::Mul(cy, cy);
+        typename Ops::Vec q = Ops::Add(Ops::Mul(xq, xq), y2);
+        typename Ops::Mask cardioid = Ops::LessEqual(Ops::Mul(q, Ops::Add(q, xq)), Ops::Mul(Ops::Set(0.25f), y2));
+        typename Ops::Vec xb = Ops::Add(cx, Ops::Set(1.0f));
+        typename Ops::Mask bulb = Ops::LessEqual(Ops::Add(Ops::Mul(xb, xb), y2), Ops::Set(0.0625f));
+        return Ops::Or(cardioid, bulb);
+    }
+
+    // IterateFloat of MandlebrotCore.glsl over Ops::LANES pixels at a time. A lane stops counting once it escaped,
+    // the vector stops once every lane did.
+    template<typename Ops>
+    void IterateRow(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations)
+    {
+        using Vec = typename Ops::Vec;
+        using Mask = typename Ops::Mask;
+
+        const Vec escapeRadiusSquared = Ops::Set(params.interiorCulling ? 4.0f : 2.0f);
+        const Vec halfWidth = Ops::Set(0.5f * float(params.width));
+        const Vec step = Ops::Set(params.step);
+        const Vec centerX = Ops::Set(params.centerX);
+        // c.y is the same for the whole row
+        const Vec cy = Ops::Set(params.centerY + (float(y) - 0.5f * float(params.height)) * params.step);
+        const Vec maxIterations = Ops::Set(float(params.maxIterations));
+        const Vec zero = Ops::Set(0.0f);
+        const Vec one = Ops::Set(1.0f);
+
+        for (uint32_t i = 0; i < count; i += Ops::LANES)
+        {
+            // Whole pixel coordinates are exact in float, so is their offset from the image center
+            Vec pixelX = Ops::Add(Ops::Set(float(x + i)), Ops::LaneIndices());
+            Vec cx = Ops::Add(centerX, Ops::Mul(Ops::Sub(pixelX, halfWidth), step));
+
+            Mask active = Ops::All();
+            Vec n = zero;
+            if (params.interiorCulling)
+            {
+                Mask interior = InMainCardioidOrBulb<Ops>(cx, cy);
+                active = Ops::AndNot(interior, active);
+                n = Ops::Select(interior, maxIterations, zero);
+            }
+
+            Vec zx = zero;
+            Vec zy = zero;
+            for (uint32_t k = 0; k < params.maxIterations && Ops::Any(active); k++)
+            {
+                Vec zx2 = Ops::Mul(zx, zx);
+                Vec zy2 = Ops::Mul(zy, zy);
+                zy = Ops::Add(Ops::Mul(Ops::Add(zx, zx), zy), cy);
+                zx = Ops::Add(Ops::Sub(zx2, zy2), cx);
+
+                Mask escaped = Ops::Greater(Ops::Add(Ops::Mul(zx, zx), Ops::Mul(zy, zy)), escapeRadiusSquared);
+                active = Ops::AndNot(escaped, active);
+                n = Ops::Add(n, Ops::Select(active, one, zero));
+            }
+
+            if (count - i >= Ops::LANES)
+            {
+                Ops::Store(iterations + i, n);
+            }
+            else
+            {
+                float lanes[Ops::LANES];
+                Ops::Store(lanes, n);
+                for (uint32_t lane = 0; lane < count - i; lane++)
+                    iterations[i + lane] = lanes[lane];
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "Utils.h"
+#include <memory>
+#include <vector>
+
+// Ring of N frames in flight, N is independent of the swapchain image count. Every slot owns a timeline semaphore
+// (values laid out as frameIndex * (NUM_STAGES - 1) + stage) and a binary semaphore for vkAcquireNextImageKHR.
+// BeginFrame() waits until the slot's previous frame reached the retire stage, EndFrame() moves to the next slot.
+// Tasks index their own per frame command buffers and resources with Frame::slot.
+class FrameRing
+{
+private:
+    FrameRing() = delete;
+    FrameRing(FrameRing const&) = delete;
+    FrameRing const& operator= (FrameRing const&) = delete;
+
+    struct Slot
+    {
+        std::unique_ptr<TimelineSemaphore> timeline;
+        VkSemaphore imageAcquiredSemaphore = VK_NULL_HANDLE;
+    };
+
+    const VkDevice& m_device;
+    TimelineStages m_retireStage;
+    std::vector<Slot> m_slots;
+
+    uint32_t m_currentSlot = 0;
+    uint64_t m_frameIndex = 0;
+    bool m_frameBegun = false;
+
+    // Host wait until the slot's last ended frame reached the retire stage, false when the slot was never used
+    bool WaitForSlot(uint32_t slot);
+
+public:
+    struct Frame
+    {
+        uint32_t slot;
+        uint64_t index;                     // frames begun so far, over all slots
+        TimelineSemaphore& timeline;
+        const VkSemaphore& imageAcquiredSemaphore;
+        bool slotRetired;                   // an earlier frame of this slot completed, its results (timestamps) can be read
+    };
+
+    // retireStage is the last stage a frame signals: SAFE_TO_PRESENT for the render loop, COMPUTE_FINISHED when
+    // only compute runs
+    FrameRing(const VkDevice& device, uint32_t framesInFlight, TimelineStages retireStage = SAFE_TO_PRESENT);
+    ~FrameRing();
+
+    Frame BeginFrame();
+    void EndFrame();
+
+    // Waits for every frame ended so far
+    void WaitIdle();
+
+    uint32_t GetFramesInFlight() const;
+    uint32_t GetCurrentSlot() const;
+    uint64_t GetFrameIndex() const;
+};
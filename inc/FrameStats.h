@@ -0,0 +1,102 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+enum class FramePhase
+{
+    FENCE_WAIT,     // host wait on the frame in flight's previous SAFE_TO_PRESENT
+    RECORD,         // command buffer recording, all tasks
+    SUBMIT,         // vkQueueSubmit2, all tasks
+    ACQUIRE,        // vkAcquireNextImageKHR
+    PRESENT,        // vkQueuePresentKHR
+    FRAME,          // whole frame, begin to begin
+    NUM_PHASES
+};
+
+// Fixed size log-linear histogram of durations in microseconds (8 sub-buckets per power of two, ~12% resolution).
+// Recording is a single relaxed atomic increment, so it can be fed from any thread and read while being fed.
+class LatencyHistogram
+{
+private:
+    static constexpr uint32_t SUB_BUCKET_BITS = 3;
+    static constexpr uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr uint32_t MAX_POWER = 24;    // last power of two with sub-buckets, [2^24, 2^25) us is ~16-33 s
+    // SUB_BUCKETS exact values, SUB_BUCKETS per power from SUB_BUCKET_BITS to MAX_POWER, then one overflow bucket
+    static constexpr uint32_t NUM_BUCKETS = (MAX_POWER - SUB_BUCKET_BITS + 2) * SUB_BUCKETS + 1;
+    static constexpr uint32_t OVERFLOW_BUCKET = NUM_BUCKETS - 1;
+
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> m_buckets{};
+    std::atomic<uint64_t> m_count{ 0 };
+    std::atomic<uint64_t> m_sumUs{ 0 };
+
+    static uint32_t GetBucketIndex(uint64_t us);
+    static double GetBucketUpperBound(uint32_t index);
+
+public:
+    void Record(uint64_t us);
+    void Reset();
+
+    uint64_t GetCount() const;
+    double GetAverage() const;
+    // Upper bound of the bucket holding the given percentile (0-100), in microseconds
+    double GetPercentile(double percentile) const;
+};
+
+// Per phase histograms of the frame loop. Phase times are summed over the frame and recorded once per frame,
+// a summary is written every m_dumpInterval frames to stdout or appended to a .csv / .json file.
+class FrameStats
+{
+private:
+    FrameStats() = default;
+    FrameStats(FrameStats const&) = delete;
+    FrameStats const& operator= (FrameStats const&) = delete;
+
+    std::array<LatencyHistogram, (size_t)FramePhase::NUM_PHASES> m_histograms;
+    std::array<uint64_t, (size_t)FramePhase::NUM_PHASES> m_currentFrameUs{};
+    std::chrono::steady_clock::time_point m_frameBegin{};
+
+    uint64_t m_frameCount = 0;
+    uint64_t m_dumpInterval = 600;
+    std::string m_outputPath;
+
+    void Dump();
+
+public:
+    static FrameStats& Get();
+
+    // An empty path prints to stdout, otherwise the extension (.csv / .json) picks the format
+    void Configure(uint64_t dumpInterval, const std::string& outputPath);
+
+    void AddPhaseTime(FramePhase phase, uint64_t us);
+    void EndFrame();
+
+    class ScopedTimer
+    {
+    private:
+        FramePhase m_phase;
+        std::chrono::steady_clock::time_point m_begin;
+
+    public:
+        ScopedTimer(FramePhase phase) : m_phase(phase), m_begin(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer()
+        {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_begin).count();
+            FrameStats::Get().AddPhaseTime(m_phase, (uint64_t)us);
+        }
+    };
+};
+
+#if defined(ENABLE_FRAME_STATS)
+#define FRAME_STATS_CONCAT_INNER(a, b) a##b
+#define FRAME_STATS_CONCAT(a, b) FRAME_STATS_CONCAT_INNER(a, b)
+#define FRAME_STATS_SCOPE(phase) FrameStats::ScopedTimer FRAME_STATS_CONCAT(frameStatsTimer, __LINE__)(FramePhase::phase)
+#define FRAME_STATS_END_FRAME() FrameStats::Get().EndFrame()
+#define FRAME_STATS_CONFIGURE(interval, path) FrameStats::Get().Configure(interval, path)
+#else
+#define FRAME_STATS_SCOPE(phase)
+#define FRAME_STATS_END_FRAME()
+#define FRAME_STATS_CONFIGURE(interval, path)
+#endif
@@ -0,0 +1,123 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// GPU timings from timestamp queries. The query pool is split into one ring segment per frame in flight,
+// scopes recorded for a frame land in that frame's segment and are read back by Collect() once the frame's
+// SAFE_TO_PRESENT value has signaled, so reading never stalls. Segments are recycled with a host side reset.
+// Scopes in command buffers that are recorded once and resubmitted use a reserved slot (same query pair in every
+// frame's segment, taken from the end of the segment) and are marked active with SubmitReservedScope() per submission.
+class GpuProfiler
+{
+public:
+    struct ScopeSummary
+    {
+        double minMs = 0.0;
+        double avgMs = 0.0;
+        double p99Ms = 0.0;
+        uint64_t count = 0;
+    };
+
+private:
+    GpuProfiler(GpuProfiler const&) = delete;
+    GpuProfiler const& operator= (GpuProfiler const&) = delete;
+
+    struct ActiveScope
+    {
+        uint32_t slot;
+        const char* name;
+    };
+
+    struct FrameQueries
+    {
+        std::vector<ActiveScope> scopes;
+        uint32_t nextSlot = 0;
+        std::map<std::string, double> collected;    // durations (ms) the last Collect read for this frame in flight
+    };
+
+    struct ScopeStatistics
+    {
+        std::vector<double> samples;    // ring of the most recent durations (ms) for percentiles
+        size_t nextSample = 0;
+        uint64_t count = 0;
+        double sum = 0.0;
+        double min = 0.0;
+    };
+
+    const VkDevice& m_device;
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    uint32_t m_maxScopesPerFrame;
+    uint32_t m_maxFrameInFlights;
+    double m_timestampPeriod;
+    uint64_t m_timestampMask;
+    bool m_enabled;
+
+    std::vector<FrameQueries> m_frames;
+    std::vector<const char*> m_reservedScopeNames;     // index i owns slot m_maxScopesPerFrame - 1 - i
+    std::map<std::string, ScopeStatistics> m_statistics;
+
+    uint32_t GetFirstQuery(uint32_t frameInFlight) const;
+    uint32_t GetReservedSlotCount() const;
+
+public:
+    // Every family timestamps get written on has to support them, the narrowest one decides the valid bits
+    GpuProfiler(const VkDevice& device, const VkPhysicalDevice& physicalDevice, const std::vector<uint32_t>& queueFamilyIndices,
+        uint32_t maxFrameInFlight, uint32_t maxScopesPerFrame = 16);
+    ~GpuProfiler();
+
+    // Writes the opening timestamp, returns the scope id to hand to EndScope. name has to outlive the frame.
+    uint32_t BeginScope(const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, const char* name);
+    void EndScope(const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, uint32_t scope);
+
+    // Slot for a scope living in a pre-recorded command buffer, valid for every frame in flight
+    uint32_t ReserveScope(const char* name);
+    uint32_t BeginReservedScope(const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, uint32_t reservedScope);
+    // Call for every submission of a command buffer holding the reserved scope, its timestamps are then collected
+    void SubmitReservedScope(uint32_t frameInFlight, uint32_t reservedScope);
+
+    // Only call once every submission of this frame in flight has completed
+    void Collect(uint32_t frameInFlight);
+
+    // Drops everything collected so far, e.g. after warm-up frames
+    void ResetStatistics();
+
+    // Zeroed summary when nothing was recorded under that name
+    ScopeSummary GetSummary(const std::string& name) const;
+    // Duration the last Collect(frameInFlight) read for the scope, i.e. from that frame in flight's previous frame.
+    // False when that frame didn't record the scope or its timestamps weren't available.
+    bool GetFrameSample(uint32_t frameInFlight, const std::string& name, double& ms) const;
+
+    // Per scope min / avg / p99 in milliseconds
+    void PrintStatistics() const;
+};
+
+// Times everything recorded into the command buffer while the object is alive
+class GpuProfileScope
+{
+private:
+    GpuProfiler& m_profiler;
+    const VkCommandBuffer& m_commandBuffer;
+    uint32_t m_frameInFlight;
+    uint32_t m_scope;
+
+public:
+    GpuProfileScope(GpuProfiler& profiler, const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, const char* name) :
+        m_profiler(profiler), m_commandBuffer(commandBuffer), m_frameInFlight(frameInFlight)
+    {
+        m_scope = m_profiler.BeginScope(m_commandBuffer, m_frameInFlight, name);
+    }
+
+    // Scope in a command buffer recorded once, see GpuProfiler::ReserveScope
+    GpuProfileScope(GpuProfiler& profiler, const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, uint32_t reservedScope) :
+        m_profiler(profiler), m_commandBuffer(commandBuffer), m_frameInFlight(frameInFlight)
+    {
+        m_scope = m_profiler.BeginReservedScope(m_commandBuffer, m_frameInFlight, reservedScope);
+    }
+
+    ~GpuProfileScope()
+    {
+        m_profiler.EndScope(m_commandBuffer, m_frameInFlight, m_scope);
+    }
+};
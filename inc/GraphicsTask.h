@@ -1,17 +1,41 @@
 #pragma once
 #include "Utils.h"
 
+// Inputs baked into the pre-recorded command buffers, any change means re-recording
+enum GraphicsTaskDirtyBits
+{
+    DIRTY_VIEWPORT = 1 << 0,
+    DIRTY_ATTACHMENTS = 1 << 1,
+    DIRTY_PIPELINE = 1 << 2,
+    DIRTY_DESCRIPTORS = 1 << 3,
+    DIRTY_ALL = DIRTY_VIEWPORT | DIRTY_ATTACHMENTS | DIRTY_PIPELINE | DIRTY_DESCRIPTORS
+};
+
 class GraphicsTask
 {
 private:
     const VkQueue& m_graphicsQueue;
     const VkDevice& m_device;
+    MemoryAllocator& m_allocator;
+    GpuProfiler& m_profiler;
+    ImmediateSubmitContext& m_immediateContext;
 
     VkCommandPool m_commandPool;
     std::vector<VkCommandBuffer> m_commandBuffers;
     VkPipelineLayout m_pipelineLayout;
     VkShaderModule m_shaderModule;
 
+    // The full screen quad samples the compute task output of the same frame in flight
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_descriptorSets;
+
+    // Acquire half of the ownership transfer of the sampled images, when the compute task runs in another family
+    uint32_t m_queueFamilyIndex;
+    uint32_t m_acquireQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+    std::vector<VkImage> m_sampledImages;
+
     VkDeviceMemory m_bufferMemory = VK_NULL_HANDLE;
     VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
     VkBuffer m_indexBuffer = VK_NULL_HANDLE;
@@ -20,7 +44,7 @@ private:
     VkShaderModule m_fragmentShaderModule = VK_NULL_HANDLE;
 
     std::vector<VkImage> m_colorAttachments;
-    std::vector<VkDeviceMemory> m_colorAttachmentMemory;
+    std::vector<MemoryAllocation> m_colorAttachmentMemory;
     std::vector<VkImageView> m_colorAttachmentViews;
     
     VkPipeline m_pipeline;
@@ -28,17 +52,40 @@ private:
     uint32_t m_screenHeight;
     uint32_t m_maxFrameInFlights;
 
-    void BuildCommandBuffers(const uint32_t& frameInFlight, bool changeImageLayout);
+    // Each frame in flight's command buffer is recorded once and resubmitted until one of its inputs changes
+    std::vector<uint32_t> m_dirtyMasks;
+    uint64_t m_recordCount = 0;
+    uint32_t m_profileScope;
+
+    // Set by Resize(), the frame in flight's attachment is recreated at the next Update() for that frame
+    std::vector<bool> m_pendingResize;
+
+    void CreateColorAttachment(const uint32_t& frameInFlight);
+    void DestroyColorAttachment(const uint32_t& frameInFlight);
+    void BuildCommandBuffers(const uint32_t& frameInFlight);
 
 public:
 
-    GraphicsTask(const VkDevice& device, const VkPhysicalDevice& physicalDevice, const VkQueue& graphicsQueue,
-        uint32_t queueFamilyIndex, uint32_t maxFrameInFlight, uint32_t screenWidth, uint32_t screenHeight);
+    // The attachment transitions are recorded into immediateContext's open batch, submitting it is up to the caller
+    GraphicsTask(const VkDevice& device, MemoryAllocator& allocator, const VkPipelineCache& pipelineCache, GpuProfiler& profiler,
+        ImmediateSubmitContext& immediateContext, const VkQueue& graphicsQueue, uint32_t queueFamilyIndex, uint32_t maxFrameInFlight, uint32_t screenWidth, uint32_t screenHeight,
+        const std::vector<VkImageView>& sampledImageViews);
     ~GraphicsTask();
 
     //Create quad draw specific resources
     void Init();
-    void Update(const uint32_t& frameIndex, const uint32_t& frameInFlight,
-        const VkSemaphore& timelineSem, uint64_t signalValue, uint64_t waitValue);
+    void Update(const uint32_t& frameInFlight, const VkSemaphore& timelineSem, uint64_t signalValue, uint64_t waitValue);
     const std::vector<VkImage>& GetColorAttachments();
+
+    // New attachment size, applied lazily per frame in flight so no frame still in flight has to be drained
+    void Resize(uint32_t screenWidth, uint32_t screenHeight);
+
+    // The sampled images are released by srcQueueFamilyIndex (see ComputeTask::SetReleaseQueueFamily), every
+    // command buffer acquires its frame in flight's image before the draw
+    void SetAcquireQueueFamily(uint32_t srcQueueFamilyIndex, const std::vector<VkImage>& sampledImages);
+
+    // Combination of GraphicsTaskDirtyBits, applies to every frame in flight
+    void MarkDirty(uint32_t dirtyBits);
+    // Number of command buffer recordings so far, maxFrameInFlight when nothing ever changed
+    uint64_t GetRecordCount() const;
 };
\ No newline at end of file
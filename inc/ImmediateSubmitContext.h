@@ -0,0 +1,58 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <vector>
+
+// Persistent replacement for the create pool / allocate / fence / submit / wait / destroy dance of one-off work
+// (layout transitions, uploads). Commands recorded through Begin() accumulate in a single command buffer until
+// Submit(), so a burst of resource creation ends up as one submission. Every submission signals the next value of
+// a timeline semaphore, that value is the ticket callers can wait on (host) or hand to a queue submit (GPU).
+// Command buffers come from one resettable pool and are recycled once their ticket has signaled. Not thread safe.
+class ImmediateSubmitContext
+{
+public:
+    using Ticket = uint64_t;
+
+private:
+    ImmediateSubmitContext(ImmediateSubmitContext const&) = delete;
+    ImmediateSubmitContext const& operator= (ImmediateSubmitContext const&) = delete;
+
+    struct InFlightCommandBuffer
+    {
+        VkCommandBuffer commandBuffer;
+        Ticket ticket;
+    };
+
+    const VkDevice& m_device;
+    const VkQueue& m_queue;
+
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+
+    VkCommandBuffer m_recordingCommandBuffer = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> m_freeCommandBuffers;
+    std::deque<InFlightCommandBuffer> m_inFlightCommandBuffers;   // ordered by ticket
+
+    Ticket m_lastSubmittedTicket = 0;
+    uint64_t m_submitCount = 0;
+
+    // Moves the command buffers of completed tickets back to the free list
+    void Recycle();
+
+public:
+    ImmediateSubmitContext(const VkDevice& device, const VkQueue& queue, uint32_t queueFamilyIndex);
+    ~ImmediateSubmitContext();
+
+    // Command buffer of the open batch, begins a new one if nothing is being recorded
+    VkCommandBuffer Begin();
+
+    // Submits the open batch. Returns the ticket of the batch, or of the last submission when nothing was recorded.
+    Ticket Submit();
+    void Wait(Ticket ticket);
+    bool IsComplete(Ticket ticket);
+    void SubmitAndWait();
+
+    // Lets a queue submission wait on a ticket instead of the host
+    const VkSemaphore& GetSemaphore() const;
+    uint64_t GetSubmitCount() const;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include "ComputeTask.h"
+#include <string>
+#include <vector>
+
+class VulkanManager;
+
+// Times Mandlebrot.comp over a matrix of workgroup shapes and unroll factors (all specialization constants, so no
+// shader gets recompiled) and keeps the fastest. The winner is persisted in CACHE_PATH/autotune.txt, one line per
+// device keyed by its UUID, so only the first run on a device (or driver version) pays for tuning.
+// Tuning runs headless on the compute queue with the task's own storage images.
+class KernelAutotuner
+{
+private:
+    KernelAutotuner(KernelAutotuner const&) = delete;
+    KernelAutotuner const& operator= (KernelAutotuner const&) = delete;
+
+    VulkanManager& m_vulkanManager;
+    uint32_t m_imageWidth;
+    uint32_t m_imageHeight;
+
+    std::string m_deviceKey;        // device UUID as hex
+    uint32_t m_driverVersion = 0;
+    uint32_t m_maxWorkGroupSize[2]{};
+    uint32_t m_maxWorkGroupInvocations = 0;
+
+    std::vector<MandlebrotSettings> GetCandidates(const MandlebrotSettings& base) const;
+    // Average GPU time of one dispatch in milliseconds
+    double Measure(const MandlebrotSettings& settings);
+
+    bool Load(MandlebrotSettings& settings) const;
+    void Save(const MandlebrotSettings& settings, double gpuMs) const;
+
+public:
+    KernelAutotuner(VulkanManager& vulkanManager, uint32_t imageWidth, uint32_t imageHeight);
+
+    // The persisted configuration for this device, tuned first when there is none (or retune is set).
+    // Only workgroup size and unroll come from tuning, maxIterations stays what base asks for.
+    MandlebrotSettings LoadOrTune(const MandlebrotSettings& base, bool retune = false);
+    MandlebrotSettings Tune(const MandlebrotSettings& base);
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+// A sub-allocation handed out by the MemoryAllocator, bind resources with (memory, offset)
+struct MemoryAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeIndex = 0;
+    // Persistently mapped pointer (already offset) for host visible memory, nullptr otherwise
+    void* mappedData = nullptr;
+};
+
+// Carves resources out of large per memory type blocks instead of calling vkAllocateMemory per resource.
+// Each block keeps its live sub-allocations sorted by offset, the gaps between them form the free list:
+// new requests are bumped onto the tail of the block when possible, otherwise placed first fit into a gap,
+// and freeing a sub-allocation merges its range back with the neighbouring gaps automatically.
+// Linear (buffers) and optimal (images) resources are kept bufferImageGranularity apart when they share a page.
+// Not thread safe, all calls are expected from the thread owning the VulkanManager.
+class MemoryAllocator
+{
+public:
+    struct HeapStatistics
+    {
+        VkDeviceSize heapSize = 0;
+        VkDeviceSize reservedBytes = 0;   // sum of vkAllocateMemory sizes
+        VkDeviceSize usedBytes = 0;       // sum of live sub-allocation sizes
+        uint32_t blockCount = 0;
+        uint32_t allocationCount = 0;
+    };
+
+private:
+    MemoryAllocator(MemoryAllocator const&) = delete;
+    MemoryAllocator const& operator= (MemoryAllocator const&) = delete;
+
+    struct SubAllocation
+    {
+        VkDeviceSize size;
+        bool linear;
+    };
+
+    struct Block
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        void* mappedData = nullptr;
+        bool dedicated = false;
+        std::map<VkDeviceSize, SubAllocation> allocations;
+    };
+
+    const VkDevice& m_device;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize m_bufferImageGranularity = 1;
+    VkDeviceSize m_preferredBlockSize;
+
+    // Indexed by memory type
+    std::vector<std::vector<std::unique_ptr<Block>>> m_blocks;
+
+    bool TryAllocateFromBlock(Block& block, const VkMemoryRequirements& memoryRequirements, bool linear, VkDeviceSize& offset) const;
+    Block* CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated);
+    void DestroyBlock(Block& block);
+
+public:
+    MemoryAllocator(const VkDevice& device, const VkPhysicalDevice& physicalDevice, VkDeviceSize preferredBlockSize = 64ull * 1024 * 1024);
+    ~MemoryAllocator();
+
+    // Returns the first memory type allowed by memoryTypeBits that has requiredFlags, favouring the ones that also have preferredFlags
+    uint32_t FindMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags = 0) const;
+    const VkMemoryType& GetMemoryType(uint32_t memoryTypeIndex) const;
+
+    // linear has to be true for buffers and linear tiled images, false for optimal tiled images
+    MemoryAllocation Allocate(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags requiredFlags,
+        VkMemoryPropertyFlags preferredFlags, bool linear);
+    void Free(MemoryAllocation& allocation);
+
+    // One entry per memory heap
+    std::vector<HeapStatistics> GetHeapStatistics() const;
+    void PrintStatistics() const;
+};
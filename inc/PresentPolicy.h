@@ -0,0 +1,39 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What the swapchain is tuned for. The mode picks the preferred present modes, image count and frames in flight,
+// imageCount / framesInFlight override the mode's choice when non zero. Everything is clamped to what the surface
+// supports when the swapchain gets created.
+struct PresentPolicy
+{
+    enum class Mode
+    {
+        DEFAULT,        // MAILBOX with 3 images if available, FIFO otherwise, image count - 1 frames in flight
+        LOW_LATENCY,    // IMMEDIATE / MAILBOX, fewest images, 1 frame in flight
+        THROUGHPUT,     // MAILBOX / IMMEDIATE, deep queue, image count - 1 frames in flight
+        POWER_SAVING    // FIFO, vsync paced, fewest images, 1 frame in flight
+    };
+
+    Mode mode = Mode::DEFAULT;
+    uint32_t imageCount = 0;
+    uint32_t framesInFlight = 0;
+};
+
+// Outcome of resolving a PresentPolicy against a surface
+struct PresentConfiguration
+{
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t imageCount = 0;
+    uint32_t framesInFlight = 0;
+};
+
+PresentConfiguration ResolvePresentPolicy(const PresentPolicy& policy, const VkSurfaceCapabilitiesKHR& capabilities,
+    const std::vector<VkPresentModeKHR>& supportedModes);
+
+// "default", "low-latency", "throughput", "power-saving"
+bool ParsePresentPolicyMode(const std::string& name, PresentPolicy::Mode& mode);
+const char* GetPresentPolicyModeName(PresentPolicy::Mode mode);
+const char* GetPresentModeName(VkPresentModeKHR presentMode);
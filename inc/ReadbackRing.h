@@ -0,0 +1,77 @@
+#pragma once
+#include "Utils.h"
+#include <functional>
+#include <vector>
+
+// A frame's pixels as they landed in host memory. pixels points straight into the mapped staging buffer and stays
+// valid until that frame in flight records its next copy, i.e. until the frame ring comes back to the slot.
+struct ReadbackFrame
+{
+    uint64_t frameIndex = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t rowPitch = 0;          // bytes, rows are tightly packed RGBA8
+    const uint8_t* pixels = nullptr;
+};
+
+// GPU to host readback without stalls: one persistently mapped staging buffer per frame in flight, host cached when
+// the device has such memory (reading uncached memory is slow). The frame's command buffer copies the output image
+// into its buffer, the host only looks at the data once the timeline value covering the copy signaled, so polling
+// never waits. A frame nobody polled before its slot came round again is dropped. Not thread safe.
+class ReadbackRing
+{
+private:
+    ReadbackRing(ReadbackRing const&) = delete;
+    ReadbackRing const& operator= (ReadbackRing const&) = delete;
+
+    enum class SlotState
+    {
+        IDLE,
+        RECORDED,   // copy recorded, not submitted yet
+        PENDING,    // submitted, waiting for signalValue
+    };
+
+    struct Slot
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        MemoryAllocation memory{};
+        SlotState state = SlotState::IDLE;
+        uint64_t frameIndex = 0;
+        VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+        uint64_t signalValue = 0;
+    };
+
+    const VkDevice& m_device;
+    MemoryAllocator& m_allocator;
+    uint32_t m_width;
+    uint32_t m_height;
+    bool m_hostCached = false;
+    bool m_coherent = true;         // the chosen memory type needs no invalidation
+    std::vector<Slot> m_slots;
+    uint64_t m_droppedFrames = 0;
+
+    // Index of the oldest pending slot whose copy completed, false when there is none
+    bool FindCompleted(uint32_t& slot);
+    ReadbackFrame Deliver(uint32_t slot);
+
+public:
+    ReadbackRing(const VkDevice& device, const VkPhysicalDevice& physicalDevice, MemoryAllocator& allocator,
+        uint32_t framesInFlight, uint32_t width, uint32_t height);
+    ~ReadbackRing();
+
+    // Records the copy of image (GENERAL layout, last written at srcStageMask / srcAccessMask) into the frame in
+    // flight's buffer. The image stays in GENERAL, later barriers on it have to wait for COPY.
+    void RecordCopy(const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, const VkImage& image,
+        VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask);
+    // The command buffer with the frame in flight's copy was submitted, signalValue on timelineSemaphore covers it
+    void OnSubmitted(uint32_t frameInFlight, uint64_t frameIndex, const VkSemaphore& timelineSemaphore, uint64_t signalValue);
+
+    // Oldest completed frame not handed out yet, false when the GPU isn't done with any
+    bool Poll(ReadbackFrame& frame);
+    // Hands every completed frame to callback, oldest first. Returns how many there were.
+    uint32_t Poll(const std::function<void(const ReadbackFrame&)>& callback);
+
+    // Completed frames overwritten before anybody polled them
+    uint64_t GetDroppedFrameCount() const;
+    bool IsHostCached() const;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include "BigFixed.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Orbit Z(n+1) = Z(n)^2 + C of the reference point C, iterated in BigFixed and stored in float. The perturbation
+// kernel only iterates each pixel's small difference to it, the float precision of Z itself is enough for that.
+struct ReferenceOrbit
+{
+    BigFixed centerX;
+    BigFixed centerY;
+    uint32_t maxIterations = 0;
+    // Z(0) = 0 up to the first point past |Z| = 2 or Z(maxIterations), x / y interleaved (a vec2 array in the shader)
+    std::vector<float> points;
+    uint64_t version = 0;
+
+    uint32_t GetLength() const { return (uint32_t)(points.size() / 2); }
+};
+
+// Computes reference orbits on a worker thread so a new orbit (new center, or more limbs as the zoom deepens)
+// never stalls the frame loop, the renderer keeps using the latest finished orbit meanwhile.
+// An orbit is sequential by nature, one orbit only ever occupies one thread.
+class ReferenceOrbitBuilder
+{
+private:
+    ReferenceOrbitBuilder(ReferenceOrbitBuilder const&) = delete;
+    ReferenceOrbitBuilder const& operator= (ReferenceOrbitBuilder const&) = delete;
+
+    struct OrbitRequest
+    {
+        BigFixed centerX;
+        BigFixed centerY;
+        uint32_t maxIterations = 0;
+    };
+
+    std::thread m_worker;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+
+    OrbitRequest m_lastRequest;         // dedupes Request() calls, the frame loop asks every frame
+    bool m_hasRequest = false;          // m_request is queued, not picked up yet
+    bool m_busy = false;                // the worker is computing an orbit
+    bool m_quit = false;
+    OrbitRequest m_request;
+
+    std::shared_ptr<const ReferenceOrbit> m_latest;
+    uint64_t m_nextVersion = 1;
+
+    void WorkerLoop();
+
+public:
+    ReferenceOrbitBuilder();
+    ~ReferenceOrbitBuilder();
+
+    // Queues the orbit of (centerX, centerY), replacing a queued one that didn't start yet. Does nothing when it's
+    // the orbit last asked for.
+    void Request(const BigFixed& centerX, const BigFixed& centerY, uint32_t maxIterations);
+
+    // Latest finished orbit, nullptr before the first one
+    std::shared_ptr<const ReferenceOrbit> GetLatest() const;
+    // Blocks until every requested orbit is done
+    std::shared_ptr<const ReferenceOrbit> WaitForLatest();
+
+    static std::vector<float> Compute(const BigFixed& centerX, const BigFixed& centerY, uint32_t maxIterations);
+    // Limbs to resolve pixelStep with guard bits to spare, in whole limbs so the orbit only changes every 32 bits of zoom
+    static uint32_t GetLimbCount(double pixelStep);
+};
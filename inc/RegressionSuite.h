@@ -0,0 +1,84 @@
+#pragma once
+#include "ComputeTask.h"
+#include "CpuMandlebrot.h"
+#include <string>
+#include <vector>
+
+class VulkanManager;
+
+// Golden image and performance regression checks, run by VulkanComputeBench --validate (ctest runs it as
+// mandlebrot_regression). Every case renders a fixed view headless, reads one more frame back through a ReadbackRing
+// and compares it with the reference: <golden dir>/<case>.ppm when there is one, CpuMandlebrot's image of the view
+// otherwise (its float kernel for float frames, long double for the df64 and perturbation ones). A case without
+// either fails. GPUs differ in the last float bits, which moves the odd pixel to the next iteration count, hence the
+// tolerance. The frame ring's timeline values are checked as well, and the per frame GPU / host times against the
+// device's lines in the baseline file. Cases the file has no line for get recorded, later runs compare against them.
+// Needs nothing but a Vulkan 1.3 device, a software ICD (VK_ICD_FILENAMES pointing at lavapipe) works.
+class RegressionSuite
+{
+public:
+    struct Options
+    {
+        std::string goldenDirectory = std::string(ASSETS_PATH) + "golden/";
+        std::string baselinePath;       // empty: <golden dir>/baseline.txt
+        bool updateGolden = false;      // write the rendered images as the new goldens instead of comparing
+        bool updateBaseline = false;    // write the measured times as this device's baseline, recorded ones too
+        uint32_t channelTolerance = 8;  // largest per channel difference of a matching pixel
+        double pixelTolerance = 0.005;  // fraction of the pixels allowed to mismatch
+        double maxSlowdown = 1.25;      // slower than baseline * maxSlowdown fails
+    };
+
+    struct CaseResult
+    {
+        std::string name;
+        std::string reference;          // "golden" or "cpu", empty when there was none
+        double mismatchedPixelFraction = 0.0;
+        uint32_t maxChannelDifference = 0;
+        bool timelineValid = true;
+        double gpuMs = -1.0;            // per frame, -1 without timestamps
+        double hostMs = 0.0;            // per frame, recording and submitting
+        bool baselineFound = false;     // the file had a line for the case, false when this run recorded it
+        double baselineGpuMs = -1.0;    // -1 without a baseline
+        double baselineHostMs = -1.0;
+        bool passed = false;
+        std::string failure;            // first failed check
+    };
+
+private:
+    RegressionSuite(RegressionSuite const&) = delete;
+    RegressionSuite const& operator= (RegressionSuite const&) = delete;
+
+    struct Case
+    {
+        std::string name;
+        MandlebrotView view;
+        MandlebrotSettings settings;
+    };
+
+    VulkanManager& m_vulkanManager;
+    Options m_options;
+    std::string m_deviceName;
+    std::vector<CaseResult> m_results;
+    CpuMandlebrot m_cpuReference;
+
+    static std::vector<Case> GetCases();
+    CaseResult RunCase(const Case& testCase);
+    // RGB8 reference image of the case, false when there is none
+    bool GetReference(const Case& testCase, MandlebrotPrecision precision, std::vector<uint8_t>& rgb, std::string& source);
+    void CompareWithReference(const Case& testCase, MandlebrotPrecision precision, const std::vector<uint8_t>& pixels, CaseResult& result);
+
+    std::string GetBaselinePath() const;
+    // Fills in the baseline times from this device's lines
+    void LoadBaseline(std::vector<CaseResult>& results) const;
+    // This device's lines: the measured times for cases without a baseline (every case with updateBaseline),
+    // the loaded ones for the others
+    void SaveBaseline() const;
+
+public:
+    RegressionSuite(VulkanManager& vulkanManager, const Options& options);
+
+    // Runs every case, false when any of them failed
+    bool Run();
+    // JSON summary of the last Run
+    std::string GetReport() const;
+};
@@ -3,9 +3,13 @@
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 #include <assert.h>
+#include <functional>
 #include <tuple>
 #include <vector>
 #include <string>
+#include "MemoryAllocator.h"
+#include "GpuProfiler.h"
+#include "ImmediateSubmitContext.h"
 
 void ErrorCheck(VkResult result);
 
@@ -20,9 +24,8 @@ void FreeCommandBuffer(
     VkCommandBuffer* commandBuffer
 );
 
-VkDeviceMemory AllocateHostCoherentMemory(
-    const VkPhysicalDevice& physicalDevice,
-    const VkDevice& device,
+MemoryAllocation AllocateHostCoherentMemory(
+    MemoryAllocator& allocator,
     const VkDeviceSize& bufferSize,
     const VkMemoryRequirements& memoryRequirements
 );
@@ -41,6 +44,12 @@ void FreeMemory(
     const VkDeviceMemory& memory
 );
 
+// Return a sub-allocation obtained through the MemoryAllocator helpers
+void FreeMemory(
+    MemoryAllocator& allocator,
+    MemoryAllocation& allocation
+);
+
 void DestroyBuffer(
     const VkDevice& device,
     const VkBuffer& buffer
@@ -60,9 +69,10 @@ void CopyBufferToImage(
     const VkImage& image, const uint32_t width, const uint32_t height
 );
 
-std::tuple<VkImage, VkDeviceMemory> CreateImage(
+// Images live in device local memory sub-allocated from the allocator
+std::tuple<VkImage, MemoryAllocation> CreateImage(
     const VkDevice& device,
-    const VkPhysicalDevice& physicalDevice,
+    MemoryAllocator& allocator,
     const uint32_t width, const uint32_t height,
     const VkFormat& format, const VkImageUsageFlags& usageFlags
 );
@@ -92,29 +102,50 @@ std::tuple<VkShaderModule, VkPipelineShaderStageCreateInfo> CreateShaderModule(
     const VkShaderStageFlagBits& shaderStage
 );
 
+// Create a shader module straight from SPIR-V words, e.g. the arrays in the generated EmbeddedShaders.h
+std::tuple<VkShaderModule, VkPipelineShaderStageCreateInfo> CreateShaderModule(
+    const VkDevice& device,
+    const uint32_t* code,
+    const size_t codeSizeInBytes,
+    const VkShaderStageFlagBits& shaderStage
+);
+
 void DestroyShaderModule(
     const VkDevice& device,
     VkShaderModule shaderModule
 );
 
-std::tuple<VkBuffer, VkDeviceMemory> CreateBufferAndMemory(
+std::tuple<VkBuffer, MemoryAllocation> CreateBufferAndMemory(
     const VkDevice& device,
-    const VkPhysicalDevice& physicalDevice,
+    MemoryAllocator& allocator,
     const size_t bufferSize,
-    const VkBufferUsageFlags& bufferUsageFlags
+    const VkBufferUsageFlags& bufferUsageFlags,
+    const VkMemoryPropertyFlags& memoryPropertyFlags
 );
 
-// Copy data of the gifen size into the buffer
+// Copy data of the gifen size into the buffer, the allocation has to be host visible (persistently mapped)
 void CopyDataIntoHostCoherentMemory(
-    const VkDevice& device,
     const size_t& dataSize,
     const void* data,
-    VkDeviceMemory& memory
+    const MemoryAllocation& memory
+);
+
+// The other direction, for results the GPU wrote into host visible memory
+void CopyDataFromHostCoherentMemory(
+    const size_t& dataSize,
+    void* data,
+    const MemoryAllocation& memory
 );
 
-void ChangeImageLayout(const VkDevice& device, std::vector<VkImage>& imageList, const VkQueue& queue,
-    uint32_t queueFamilyIndex, VkImageLayout oldLayout, VkImageLayout newLayout);
+// Records a layout change of every image in the list, typically into ImmediateSubmitContext::Begin()
+void ChangeImageLayout(const VkCommandBuffer& commandBuffer, const std::vector<VkImage>& imageList,
+    VkImageLayout oldLayout, VkImageLayout newLayout);
 
+// Rewrites a text file holding a line per device (autotune.txt, baseline.txt): keeps the existing lines keepLine
+// accepts and appends newLines. Goes through a temporary file renamed over path, so a crash half way never leaves
+// a truncated file behind. False when the file couldn't be written.
+bool RewriteLines(const std::string& path, const std::function<bool(const std::string& line)>& keepLine,
+    const std::vector<std::string>& newLines);
 
 enum TimelineStages
 {
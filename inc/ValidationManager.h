@@ -10,6 +10,7 @@ class ValidationManager
 private:
     VkInstance* vulkanInstanceRef;
     VkAllocationCallbacks* pAllocatorRef;
+    bool m_headless;
 
     void AddRequiredPlatformInstanceExtensions(std::vector<const char*>* instance_extensions);
 
@@ -28,7 +29,7 @@ public:
     PFN_vkDestroyDebugUtilsMessengerEXT DestroyDebugUtilsMessengerEXT;
 
 
-    ValidationManager();
+    ValidationManager(bool headless = false);
     ~ValidationManager();
 
     void SetupDebug();
@@ -4,6 +4,23 @@
 #include "ValidationManager.h"
 #include "WindowManager.h"
 #include "Utils.h"
+#include "PresentPolicy.h"
+#include "FrameStats.h"
+
+// Queue family and the queue within it
+struct QueueLocation
+{
+    uint32_t familyIndex = 0;
+    uint32_t queueIndex = 0;
+};
+
+// Dedicated compute / transfer families are preferred, roles share a family (or a queue) when there are none
+struct QueueFamilySelection
+{
+    QueueLocation graphics;
+    QueueLocation compute;
+    QueueLocation transfer;
+};
 
 class VulkanManager
 {
@@ -13,14 +30,19 @@ private:
 
     std::unique_ptr<ValidationManager> m_validationManagerObj;
     std::unique_ptr<WindowManager> m_windowManagerObj;
+    std::unique_ptr<MemoryAllocator> m_memoryAllocator;
+    std::unique_ptr<GpuProfiler> m_gpuProfiler;
+    std::unique_ptr<ImmediateSubmitContext> m_immediateSubmitContext;
 
     VkSurfaceKHR m_surface = VK_NULL_HANDLE;
     VkInstance m_instanceObj = VK_NULL_HANDLE;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
     VkDevice m_logicalDevice = VK_NULL_HANDLE;
 
-    VkQueue m_graphicsQueue = VK_NULL_HANDLE, m_computeQueue = VK_NULL_HANDLE;
+    VkQueue m_graphicsQueue = VK_NULL_HANDLE, m_computeQueue = VK_NULL_HANDLE, m_transferQueue = VK_NULL_HANDLE;
 
+    QueueFamilySelection m_queueFamilies;
+    // Graphics family
     uint32_t m_queueFamilyIndex;
 
     VkFormat m_depthFormat;
@@ -31,20 +53,84 @@ private:
     uint32_t m_swapchainImageCount = 0, m_currentSwpachainIndex = 0;
     uint32_t m_maxFrameInFlight = 0, m_frameInFlightIndex = 0;
     VkSwapchainKHR m_swapchainObj = VK_NULL_HANDLE;
+    PresentPolicy m_presentPolicy;
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
     std::vector<VkImage> m_swapchainImageList;
     std::vector<VkImageView> m_swapChainImageViewList;
+
+    // Swapchain images created with storage usage, compute writes them directly and nothing gets copied
+    bool m_storageWriteWithoutFormat = false;
+    bool m_storagePresent = false;
+
+    // Set when acquire / present report OUT_OF_DATE or SUBOPTIMAL, cleared by RecreateSwapchain()
+    bool m_swapchainOutOfDate = false;
+    bool m_imageAcquired = false;
+
+    // Last SAFE_TO_PRESENT submitted per frame in flight, once all of them signaled nothing references the images
+    // the frames were presenting to
+    struct FrameCompletion
+    {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        uint64_t value = 0;
+    };
+    std::vector<FrameCompletion> m_frameCompletions;
+
+    // Swapchains replaced by RecreateSwapchain(), destroyed once the frames in flight at the time have completed
+    struct RetiredSwapchain
+    {
+        VkSwapchainKHR swapchain;
+        std::vector<VkImageView> imageViews;
+        std::vector<FrameCompletion> pendingFrames;
+    };
+    std::vector<RetiredSwapchain> m_retiredSwapchains;
+
+    // Input to present latency. The input time is kept per frame in flight, the frame counts once vkQueuePresentKHR
+    // returned and again once the host saw its SAFE_TO_PRESENT (an upper bound when the host wasn't waiting).
+    struct FrameLatency
+    {
+        std::chrono::steady_clock::time_point inputSampled{};
+        bool presented = false;
+    };
+    std::vector<FrameLatency> m_frameLatencies;
+    LatencyHistogram m_inputToPresentLatency;
+    LatencyHistogram m_inputToCompletionLatency;
+
+    // Headless mode renders into offscreen images which stand in for the swapchain images
+    bool m_headless = false;
+    uint32_t m_headlessFramesInFlight = 2;
+    std::vector<MemoryAllocation> m_offscreenImageMemoryList;
+    VkImageLayout m_presentLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    // Shared by every pipeline creation, seeded from / written back to CACHE_PATH
+    VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+    bool m_pipelineCacheWarm = false;
  
     void CreateInstance();
     void AcquirePhysicalDevice();
-    uint32_t GetQueuesFamilyIndex();
-    void CreateLogicalDevice(const uint32_t & queueFamilyIndex);
+    QueueFamilySelection GetQueueFamilies();
+    void CreateLogicalDevice();
     void GetMaxUsableVKSampleCount();
     void FindBestDepthFormat();
     void CreateSurface(GLFWwindow* glfwWindow);
 
-    void CreateSwapchain();
+    void CreateSwapchain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
     void DestroySwapChain();
+    void CreateRenderingCompletedSemaphores();
+    // Destroys the retired swapchains whose frames have completed, all of them when waitAll is set
+    void ReleaseRetiredSwapchains(bool waitAll);
+
+    void CreateOffscreenTargets();
+    void DestroyOffscreenTargets();
+
+    // Without copyToSwapchain only srcImage is moved to TRANSFER_SRC, for frames which lost their swapchain image
+    void RecordCopyCommands(const VkImage& srcImage, bool copyToSwapchain);
 
+    void RecordPresentLatency();
+
+    void CreatePipelineCache();
+    void SaveAndDestroyPipelineCache();
+
+    // One per swapchain image, a present only releases its wait semaphore once the image is acquired again
     std::vector<VkSemaphore> m_renderingCompletedSignalSemaphore;
 
     VkCommandPool m_commandPool;
@@ -52,8 +138,11 @@ private:
 
 public:
     ~VulkanManager();
-    VulkanManager(const uint32_t& screenWidth, const uint32_t& screenHeight);
+    // The present policy picks present mode, swapchain image count and frames in flight, it is ignored when headless
+    VulkanManager(const uint32_t& screenWidth, const uint32_t& screenHeight, bool headless = false, uint32_t headlessFramesInFlight = 2,
+        const PresentPolicy& presentPolicy = PresentPolicy{});
 
+    // glfwWindow is ignored (and can be null) when running headless
     void Init(GLFWwindow* glfwWindow);
 
     void DeInit();
@@ -63,11 +152,45 @@ public:
     uint32_t GetMaxFramesInFlight() const;
     const VkDevice& GetLogicalDevice() const;
     const VkPhysicalDevice& GetPhysicalDevice() const;
+    MemoryAllocator& GetMemoryAllocator() const;
+    GpuProfiler& GetGpuProfiler() const;
+    // One-off work on the graphics queue. Init() leaves the swapchain transitions in the open batch so the tasks can
+    // add theirs, the caller submits everything once setup is done.
+    ImmediateSubmitContext& GetImmediateSubmitContext() const;
+    const VkPipelineCache& GetPipelineCache() const;
+    // True when the pipeline cache was seeded with valid data from a previous run
+    bool IsPipelineCacheWarm() const;
+    // Graphics family, also owns the swapchain images
     uint32_t GetQueueFamilyIndex() const;
+    uint32_t GetComputeQueueFamilyIndex() const;
+    uint32_t GetTransferQueueFamilyIndex() const;
+    // UINT32_MAX when the swapchain is out of date, the frame is then completed without presenting
     uint32_t GetActiveSwapchainImageIndex(const VkSemaphore& imageAquiredSignalSemaphore);
+    bool IsSwapchainOutOfDate() const;
+    // Recreates the swapchain for the current surface size, handing the old one over to the driver. Returns false
+    // (and keeps the swapchain out of date) when the surface has no area, e.g. a minimized window.
+    bool RecreateSwapchain();
+    VkExtent2D GetSurfaceExtent() const;
     const VkQueue& GetComputeQueue() const;
     const VkQueue& GetGraphicsQueue() const;
+    const VkQueue& GetTransferQueue() const;
 
     void CopyAndPresent(const VkImage& srcImage, TimelineSemaphore& semaphore, const VkSemaphore& imageAcquiredSemaphore);
+
+    // Zero-copy present path: the acquired swapchain image is a storage image for the compute task
+    bool IsStoragePresentSupported() const;
+    const VkImage& GetSwapchainImage(uint32_t index) const;
+    const VkImageView& GetSwapchainImageView(uint32_t index) const;
+    // Presents once COMPUTE_FINISHED signaled, the image already is in PRESENT_SRC. Without an acquired image
+    // (out of date swapchain, no compute work was submitted) only SAFE_TO_PRESENT is signaled.
+    void PresentStorageImage(TimelineSemaphore& semaphore);
     bool AreTheQueuesIdle();
+
+    // When the input of the current frame in flight was polled, its latency is measured from there
+    void MarkInputSampled(std::chrono::steady_clock::time_point inputSampled);
+    // Call once the host saw frameInFlight's SAFE_TO_PRESENT, before the slot is reused
+    void OnFrameCompleted(uint32_t frameInFlight);
+    // Present mode, image count, frames in flight and the input to present latency measured so far
+    void PrintPresentStatistics() const;
+    bool IsHeadless() const;
 };
@@ -17,6 +17,7 @@ private:
     WindowManager const& operator= (WindowManager const&) = delete;
 
     uint32_t m_screenWidth, m_screenHeight;
+    bool m_framebufferResized = false;
 
 public:
     ~WindowManager() {}
@@ -25,6 +26,10 @@ public:
     void                                DeInit();
     void                                Close();
     bool                                Update();
+    // True once after the framebuffer changed size
+    bool                                ConsumeResize();
+    // Blocks until there is an event, e.g. while minimized
+    void                                WaitForEvents();
 
     bool                                windowShouldRun = true;
 
@@ -0,0 +1,53 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running one batch of independent tasks at a time. Every worker starts on its own
+// contiguous share of the task indices and, once that's done, steals the back half of another worker's remaining
+// range. Neighbouring tasks (tiles of the same band) tend to cost the same, so the split follows wherever the
+// expensive part of the batch turns out to be without any up front estimate.
+class WorkStealingPool
+{
+private:
+    WorkStealingPool(WorkStealingPool const&) = delete;
+    WorkStealingPool const& operator= (WorkStealingPool const&) = delete;
+
+    // Tasks [begin, end) still owed by a worker. The owner takes from the front, thieves from the back.
+    struct TaskRange
+    {
+        std::mutex mutex;
+        uint32_t begin = 0;
+        uint32_t end = 0;
+    };
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<TaskRange>> m_ranges;
+
+    std::mutex m_mutex;
+    std::condition_variable m_batchCondition;
+    std::condition_variable m_doneCondition;
+    std::function<void(uint32_t task, uint32_t worker)> m_task;
+    uint64_t m_batch = 0;
+    uint32_t m_busyWorkers = 0;
+    bool m_quit = false;
+
+    void WorkerLoop(uint32_t worker);
+    bool TakeOwn(uint32_t worker, uint32_t& task);
+    bool Steal(uint32_t worker, uint32_t& task);
+
+public:
+    // threadCount 0 uses every hardware thread
+    explicit WorkStealingPool(uint32_t threadCount = 0);
+    ~WorkStealingPool();
+
+    // Runs task(index, worker) for every index in [0, taskCount) on the workers and returns once all are done.
+    // One batch at a time, from one thread.
+    void Run(uint32_t taskCount, const std::function<void(uint32_t task, uint32_t worker)>& task);
+
+    uint32_t GetThreadCount() const;
+};
@@ -0,0 +1,244 @@
+#include "BigFixed.h"
+#include <assert.h>
+#include <cctype>
+#include <cmath>
+
+BigFixed::BigFixed(uint32_t limbCount) :
+    m_limbs(limbCount, 0)
+{
+    assert(limbCount > 0);
+}
+
+bool BigFixed::IsZero() const
+{
+    for (uint32_t limb : m_limbs)
+    {
+        if (limb != 0)
+            return false;
+    }
+    return true;
+}
+
+int BigFixed::CompareMagnitude(const BigFixed& other) const
+{
+    assert(m_limbs.size() == other.m_limbs.size());
+    for (size_t i = 0; i < m_limbs.size(); i++)
+    {
+        if (m_limbs[i] != other.m_limbs[i])
+            return m_limbs[i] < other.m_limbs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+void BigFixed::AddMagnitude(const BigFixed& a, const BigFixed& b, BigFixed& result)
+{
+    uint64_t carry = 0;
+    for (size_t i = a.m_limbs.size(); i-- > 0;)
+    {
+        uint64_t sum = (uint64_t)a.m_limbs[i] + b.m_limbs[i] + carry;
+        result.m_limbs[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    // The integer part overflowed, way outside anything the escape test lets through
+    assert(carry == 0);
+}
+
+void BigFixed::SubtractMagnitude(const BigFixed& a, const BigFixed& b, BigFixed& result)
+{
+    uint64_t borrow = 0;
+    for (size_t i = a.m_limbs.size(); i-- > 0;)
+    {
+        uint64_t difference = (uint64_t)a.m_limbs[i] - b.m_limbs[i] - borrow;
+        result.m_limbs[i] = (uint32_t)difference;
+        borrow = (difference >> 32) & 1;
+    }
+    assert(borrow == 0);
+}
+
+void BigFixed::AddSmall(uint32_t value)
+{
+    uint64_t sum = (uint64_t)m_limbs[0] + value;
+    assert((sum >> 32) == 0);
+    m_limbs[0] = (uint32_t)sum;
+}
+
+void BigFixed::DivideSmall(uint32_t divisor)
+{
+    uint64_t remainder = 0;
+    for (uint32_t& limb : m_limbs)
+    {
+        uint64_t current = (remainder << 32) | limb;
+        limb = (uint32_t)(current / divisor);
+        remainder = current % divisor;
+    }
+}
+
+BigFixed BigFixed::FromDouble(double value, uint32_t limbCount)
+{
+    BigFixed result(limbCount);
+    double magnitude = std::fabs(value);
+    assert(magnitude < 4294967296.0);
+
+    // Every step is exact, a double has at most 53 significant bits
+    for (uint32_t& limb : result.m_limbs)
+    {
+        double whole = std::floor(magnitude);
+        limb = (uint32_t)whole;
+        magnitude = (magnitude - whole) * 4294967296.0;
+    }
+    result.m_negative = value < 0.0 && !result.IsZero();
+    return result;
+}
+
+bool BigFixed::Parse(const std::string& text, uint32_t limbCount, BigFixed& result)
+{
+    size_t position = 0;
+    bool negative = false;
+    if (position < text.size() && (text[position] == '-' || text[position] == '+'))
+        negative = text[position++] == '-';
+
+    uint64_t integerPart = 0;
+    size_t integerDigits = 0;
+    for (; position < text.size() && std::isdigit((unsigned char)text[position]); position++, integerDigits++)
+    {
+        integerPart = integerPart * 10 + (text[position] - '0');
+        if (integerPart > UINT32_MAX)
+            return false;
+    }
+
+    size_t fractionBegin = position, fractionEnd = position;
+    if (position < text.size() && text[position] == '.')
+    {
+        fractionBegin = ++position;
+        while (position < text.size() && std::isdigit((unsigned char)text[position]))
+            position++;
+        fractionEnd = position;
+    }
+
+    if (position != text.size() || integerDigits + (fractionEnd - fractionBegin) == 0)
+        return false;
+
+    // Horner from the last digit: x = (x + digit) / 10
+    BigFixed value(limbCount);
+    for (size_t i = fractionEnd; i-- > fractionBegin;)
+    {
+        value.AddSmall(text[i] - '0');
+        value.DivideSmall(10);
+    }
+    value.m_limbs[0] = (uint32_t)integerPart;
+    value.m_negative = negative && !value.IsZero();
+
+    result = value;
+    return true;
+}
+
+double BigFixed::ToDouble() const
+{
+    // Least significant first, the small limbs would be lost otherwise
+    double value = 0.0;
+    for (size_t i = m_limbs.size(); i-- > 0;)
+        value += std::ldexp((double)m_limbs[i], -32 * (int)i);
+    return m_negative ? -value : value;
+}
+
+uint32_t BigFixed::GetLimbCount() const
+{
+    return (uint32_t)m_limbs.size();
+}
+
+BigFixed BigFixed::WithLimbCount(uint32_t limbCount) const
+{
+    BigFixed result = *this;
+    result.m_limbs.resize(limbCount, 0);
+    result.m_negative = m_negative && !result.IsZero();
+    return result;
+}
+
+BigFixed BigFixed::operator+(const BigFixed& other) const
+{
+    BigFixed result(GetLimbCount());
+    if (m_negative == other.m_negative)
+    {
+        AddMagnitude(*this, other, result);
+        result.m_negative = m_negative;
+    }
+    else if (CompareMagnitude(other) >= 0)
+    {
+        SubtractMagnitude(*this, other, result);
+        result.m_negative = m_negative;
+    }
+    else
+    {
+        SubtractMagnitude(other, *this, result);
+        result.m_negative = other.m_negative;
+    }
+    result.m_negative = result.m_negative && !result.IsZero();
+    return result;
+}
+
+BigFixed BigFixed::operator-(const BigFixed& other) const
+{
+    return *this + (-other);
+}
+
+BigFixed BigFixed::operator*(const BigFixed& other) const
+{
+    assert(m_limbs.size() == other.m_limbs.size());
+    const size_t count = m_limbs.size();
+
+    // Schoolbook product, little endian: limb i of the operands weighs 2^(32 * (i - (count - 1))), the product's
+    // limb k weighs 2^(32 * (k - 2 * (count - 1))). Limbs below count - 1 are truncated.
+    std::vector<uint32_t> product(2 * count, 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t a = m_limbs[count - 1 - i];
+        if (a == 0)
+            continue;
+
+        uint64_t carry = 0;
+        for (size_t j = 0; j < count; j++)
+        {
+            uint64_t current = product[i + j] + a * other.m_limbs[count - 1 - j] + carry;
+            product[i + j] = (uint32_t)current;
+            carry = current >> 32;
+        }
+        product[i + count] = (uint32_t)carry;
+    }
+    assert(product[2 * count - 1] == 0);
+
+    BigFixed result((uint32_t)count);
+    for (size_t k = 0; k < count; k++)
+        result.m_limbs[k] = product[2 * count - 2 - k];
+    result.m_negative = (m_negative != other.m_negative) && !result.IsZero();
+    return result;
+}
+
+BigFixed BigFixed::operator-() const
+{
+    BigFixed result = *this;
+    result.m_negative = !m_negative && !IsZero();
+    return result;
+}
+
+BigFixed BigFixed::Twice() const
+{
+    BigFixed result = *this;
+    uint32_t carry = 0;
+    for (size_t i = m_limbs.size(); i-- > 0;)
+    {
+        result.m_limbs[i] = (m_limbs[i] << 1) | carry;
+        carry = m_limbs[i] >> 31;
+    }
+    assert(carry == 0);
+    return result;
+}
+
+bool BigFixed::operator==(const BigFixed& other) const
+{
+    return m_negative == other.m_negative && m_limbs == other.m_limbs;
+}
+
+bool BigFixed::operator!=(const BigFixed& other) const
+{
+    return !(*this == other);
+}
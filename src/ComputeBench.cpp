@@ -0,0 +1,593 @@
+#include "VulkanManager.h"
+#include "ComputeTask.h"
+#include "FrameRing.h"
+#include "KernelAutotuner.h"
+#include "CpuMandlebrot.h"
+#include "RegressionSuite.h"
+#include "ReadbackRing.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+// Headless Mandlebrot throughput benchmark.
+// Runs ComputeTask alone (no graphics / present) for a number of frames or a fixed duration and prints a JSON report.
+
+namespace
+{
+    struct BenchOptions
+    {
+        uint32_t width = 1024;
+        uint32_t height = 1024;
+        MandlebrotSettings settings{};
+        uint32_t framesInFlight = 2;
+        uint64_t frames = 1000;
+        double durationSeconds = 0.0;   // overrides frames when > 0
+        uint64_t warmupFrames = 10;
+        MandlebrotView view{};
+        std::string outputPath;         // stdout when empty
+        bool autotune = false;          // workgroup / unroll from the persisted autotune result
+        bool compareCulling = false;    // time the plain kernel too and report the interior culling speedup
+        bool compareGrid = false;       // time the grid kernel too and report the selected kernel's speedup
+        bool cpu = false;               // CpuMandlebrot instead of the GPU, no Vulkan device needed
+        uint32_t cpuThreads = 0;        // every hardware thread when 0
+        CpuSimdLevel cpuSimdLevel = CpuSimdLevel::AVX512;   // cap, CPUID decides below it
+        bool readback = false;          // copy every frame back to the host through a ReadbackRing
+        bool validate = false;          // RegressionSuite instead of the benchmark, exits 1 on a failed case
+        RegressionSuite::Options validation{};
+    };
+
+    struct BenchRun
+    {
+        uint64_t frames = 0;
+        double elapsedMs = 0.0;
+        double hostWorkMs = 0.0;
+        GpuProfiler::ScopeSummary gpuSummary{};
+        MandlebrotPrecision precision = MandlebrotPrecision::FLOAT;
+        double iteratedPixelFraction = 1.0;     // Mariani-Silver only, see ComputeTask::GetIteratedPixelFraction
+        double gpuRowShare = 1.0;               // hybrid only, the split the last frame settled on
+        // --readback only: frames that reached the host, dropped ones and how many frames later they arrived
+        uint64_t readbackFrames = 0;
+        uint64_t readbackDroppedFrames = 0;
+        uint64_t readbackLatencyFrames = 0;
+        bool readbackHostCached = false;
+
+        // GPU time when there are timestamps, wall time otherwise
+        double GetMsPerFrame() const
+        {
+            return gpuSummary.count > 0 ? gpuSummary.avgMs : elapsedMs / frames;
+        }
+    };
+
+    void PrintUsage()
+    {
+        std::cout << "VulkanComputeBench [options]\n"
+            << "  --width N              image width (1024)\n"
+            << "  --height N             image height (1024)\n"
+            << "  --iterations N         max iterations per pixel (128)\n"
+            << "  --workgroup XxY        workgroup size (32x32)\n"
+            << "  --unroll N             escape loop unroll factor (1)\n"
+            << "  --autotune             use the tuned workgroup / unroll for this device, tuning first if needed\n"
+            << "  --interior-culling     skip the cardioid / bulb and stop cycling orbits early\n"
+            << "  --compare-culling      time with and without interior culling and report the speedup,\n"
+            << "                         e.g. --zoom 0.3 for a mostly interior view\n"
+            << "  --kernel K             grid|persistent|mariani-silver (grid)\n"
+            << "  --persistent-workgroups N  workgroups the persistent kernel launches (picked from the workgroup size)\n"
+            << "  --compare-grid         time the grid kernel too and report the selected kernel's speedup over it\n"
+            << "  --cpu                  benchmark the CPU renderer instead, float precision only\n"
+            << "  --cpu-threads N        CPU worker threads, for --cpu and --hybrid (every hardware thread)\n"
+            << "  --cpu-simd S           scalar|sse2|avx2|avx512, widest instruction set to use (avx512)\n"
+            << "  --readback             copy every frame back to the host, polled without waiting\n"
+            << "  --hybrid               split every frame's rows between the GPU and the CPU renderer, grid kernel only\n"
+            << "  --frames-in-flight N   (2)\n"
+            << "  --frames N             timed frames (1000)\n"
+            << "  --duration S           run for S seconds instead of a frame count\n"
+            << "  --warmup N             untimed frames before measuring (10)\n"
+            << "  --zoom F               view scale (1.0), deep zooms switch to the df64 kernel\n"
+            << "  --center X Y           view center (-0.445 0), any number of digits\n"
+            << "  --precision P          auto|float|df64|perturbation (auto, picked from the zoom)\n"
+            << "  --output PATH          write the JSON report to PATH instead of stdout\n"
+            << "\n"
+            << "  --validate             run the golden image / timeline / timing regression suite instead,\n"
+            << "                         exits 0 passed, 1 failed, images without a golden are compared to the CPU renderer\n"
+            << "  --golden-dir PATH      golden images and baseline.txt (assets/golden/)\n"
+            << "  --baseline PATH        baseline times file instead of <golden dir>/baseline.txt, missing cases are recorded\n"
+            << "  --update-golden        write the rendered images as the new goldens\n"
+            << "  --update-baseline      write the measured times as this device's baseline\n"
+            << "  --pixel-tolerance F    fraction of the pixels allowed to differ from the golden (0.005)\n"
+            << "  --channel-tolerance N  largest per channel difference of a matching pixel (8)\n"
+            << "  --max-slowdown F       fail when slower than the baseline times F (1.25)\n";
+    }
+
+    bool ParseArgs(int argc, char** argv, BenchOptions& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg{ argv[i] };
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "--help" || arg == "-h")
+                return false;
+            else if (arg == "--width" && hasValue)
+                options.width = std::stoul(argv[++i]);
+            else if (arg == "--height" && hasValue)
+                options.height = std::stoul(argv[++i]);
+            else if (arg == "--iterations" && hasValue)
+                options.settings.maxIterations = std::stoul(argv[++i]);
+            else if (arg == "--workgroup" && hasValue)
+            {
+                std::string value{ argv[++i] };
+                size_t separator = value.find('x');
+                if (separator == std::string::npos)
+                    return false;
+                options.settings.workgroupSizeX = std::stoul(value.substr(0, separator));
+                options.settings.workgroupSizeY = std::stoul(value.substr(separator + 1));
+            }
+            else if (arg == "--unroll" && hasValue)
+                options.settings.unroll = std::stoul(argv[++i]);
+            else if (arg == "--autotune")
+                options.autotune = true;
+            else if (arg == "--interior-culling")
+                options.settings.interiorCulling = true;
+            else if (arg == "--compare-culling")
+                options.compareCulling = true;
+            else if (arg == "--kernel" && hasValue)
+            {
+                if (!ComputeTask::ParseKernel(argv[++i], options.settings.kernel))
+                    return false;
+            }
+            else if (arg == "--persistent-workgroups" && hasValue)
+                options.settings.persistentWorkgroups = std::stoul(argv[++i]);
+            else if (arg == "--compare-grid")
+                options.compareGrid = true;
+            else if (arg == "--cpu")
+                options.cpu = true;
+            else if (arg == "--hybrid")
+                options.settings.hybridCpu = true;
+            else if (arg == "--readback")
+                options.readback = true;
+            else if (arg == "--cpu-threads" && hasValue)
+                options.cpuThreads = options.settings.cpuThreads = std::stoul(argv[++i]);
+            else if (arg == "--cpu-simd" && hasValue)
+            {
+                if (!CpuMandlebrot::ParseSimdLevel(argv[++i], options.cpuSimdLevel))
+                    return false;
+            }
+            else if (arg == "--frames-in-flight" && hasValue)
+                options.framesInFlight = std::stoul(argv[++i]);
+            else if (arg == "--frames" && hasValue)
+                options.frames = std::stoull(argv[++i]);
+            else if (arg == "--duration" && hasValue)
+                options.durationSeconds = std::stod(argv[++i]);
+            else if (arg == "--warmup" && hasValue)
+                options.warmupFrames = std::stoull(argv[++i]);
+            else if (arg == "--zoom" && hasValue)
+                options.view.zoom = std::stod(argv[++i]);
+            else if (arg == "--center" && i + 2 < argc)
+            {
+                options.view.preciseCenterX = argv[++i];
+                options.view.preciseCenterY = argv[++i];
+                options.view.centerX = std::stod(options.view.preciseCenterX);
+                options.view.centerY = std::stod(options.view.preciseCenterY);
+            }
+            else if (arg == "--precision" && hasValue)
+            {
+                std::string value{ argv[++i] };
+                if (value == "auto")
+                    options.settings.precision = MandlebrotPrecision::AUTO;
+                else if (value == "float")
+                    options.settings.precision = MandlebrotPrecision::FLOAT;
+                else if (value == "df64")
+                    options.settings.precision = MandlebrotPrecision::DF64;
+                else if (value == "perturbation")
+                    options.settings.precision = MandlebrotPrecision::PERTURBATION;
+                else
+                    return false;
+            }
+            else if (arg == "--output" && hasValue)
+                options.outputPath = argv[++i];
+            else if (arg == "--validate")
+                options.validate = true;
+            else if (arg == "--golden-dir" && hasValue)
+                options.validation.goldenDirectory = std::string(argv[++i]) + "/";
+            else if (arg == "--baseline" && hasValue)
+                options.validation.baselinePath = argv[++i];
+            else if (arg == "--update-golden")
+                options.validation.updateGolden = true;
+            else if (arg == "--update-baseline")
+                options.validation.updateBaseline = true;
+            else if (arg == "--pixel-tolerance" && hasValue)
+                options.validation.pixelTolerance = std::stod(argv[++i]);
+            else if (arg == "--channel-tolerance" && hasValue)
+                options.validation.channelTolerance = std::stoul(argv[++i]);
+            else if (arg == "--max-slowdown" && hasValue)
+                options.validation.maxSlowdown = std::stod(argv[++i]);
+            else
+            {
+                std::cout << "Unknown argument " << arg << std::endl;
+                return false;
+            }
+        }
+
+        return options.width > 0 && options.height > 0 && options.framesInFlight > 0 && options.view.zoom > 0.0 &&
+            options.settings.workgroupSizeX > 0 && options.settings.workgroupSizeY > 0 && options.settings.maxIterations > 0 &&
+            options.settings.unroll > 0;
+    }
+
+    // Deep views replay the perturbation kernel in double against the same reference orbit, a plain double
+    // iteration can't tell the pixels apart down there
+    uint64_t CountPerturbationIterationsPerFrame(const BenchOptions& options, double step)
+    {
+        const uint32_t limbCount = ReferenceOrbitBuilder::GetLimbCount(step);
+        BigFixed centerX = BigFixed::FromDouble(options.view.centerX, limbCount);
+        BigFixed centerY = BigFixed::FromDouble(options.view.centerY, limbCount);
+        if (!options.view.preciseCenterX.empty())
+            BigFixed::Parse(options.view.preciseCenterX, limbCount, centerX);
+        if (!options.view.preciseCenterY.empty())
+            BigFixed::Parse(options.view.preciseCenterY, limbCount, centerY);
+        const std::vector<float> orbit = ReferenceOrbitBuilder::Compute(centerX, centerY, options.settings.maxIterations);
+        const uint32_t orbitLength = (uint32_t)(orbit.size() / 2);
+        const double escapeRadiusSquared = options.settings.interiorCulling ? 4.0 : 2.0;
+
+        uint64_t iterations = 0;
+        const double w = double(options.width), h = double(options.height);
+        for (uint32_t py = 0; py < options.height; py++)
+        {
+            double dcy = (double(py) - 0.5 * h) * step;
+            for (uint32_t px = 0; px < options.width; px++)
+            {
+                double dcx = (double(px) - 0.5 * w) * step;
+                double dzx = 0.0, dzy = 0.0;
+                uint32_t m = 0;
+                for (uint32_t i = 0; i < options.settings.maxIterations; i++)
+                {
+                    double zx = orbit[2 * m], zy = orbit[2 * m + 1];
+                    double nextDzx = 2.0 * (zx * dzx - zy * dzy) + dzx * dzx - dzy * dzy + dcx;
+                    dzy = 2.0 * (zx * dzy + zy * dzx) + 2.0 * dzx * dzy + dcy;
+                    dzx = nextDzx;
+                    m++;
+                    iterations++;
+
+                    zx = orbit[2 * m] + dzx;
+                    zy = orbit[2 * m + 1] + dzy;
+                    if (zx * zx + zy * zy > escapeRadiusSquared)
+                        break;
+                    if (zx * zx + zy * zy < dzx * dzx + dzy * dzy || m + 1 >= orbitLength)
+                    {
+                        dzx = zx;
+                        dzy = zy;
+                        m = 0;
+                    }
+                }
+            }
+        }
+        return iterations;
+    }
+
+    // Replays Mandlebrot.comp on the host to count the loop iterations one frame executes, the kernel itself
+    // doesn't count them so the GPU timing isn't skewed. The view is fixed during a run, so this is per frame.
+    // Runs in double, close to what the df64 kernel computes, the float kernel can diverge at deep zooms.
+    // Interior culling isn't replayed, culled pixels count the M iterations they saved: giterations_per_s is then the
+    // plain kernel's equivalent rate. Same for the pixels Mariani-Silver fills without iterating.
+    uint64_t CountIterationsPerFrame(const BenchOptions& options, MandlebrotPrecision precision)
+    {
+        const double escapeRadiusSquared = options.settings.interiorCulling ? 4.0 : 2.0;
+        // Same mapping as Mandlebrot.glsl, offsets from the image center times the pixel step
+        const double step = ComputeTask::GetPixelStep(options.view, options.width, options.height);
+        if (precision == MandlebrotPrecision::PERTURBATION)
+            return CountPerturbationIterationsPerFrame(options, step);
+
+        uint64_t iterations = 0;
+        const double w = double(options.width), h = double(options.height);
+        for (uint32_t py = 0; py < options.height; py++)
+        {
+            double cy = options.view.centerY + (double(py) - 0.5 * h) * step;
+            for (uint32_t px = 0; px < options.width; px++)
+            {
+                double cx = options.view.centerX + (double(px) - 0.5 * w) * step;
+                double zx = 0.0, zy = 0.0;
+                for (uint32_t i = 0; i < options.settings.maxIterations; i++)
+                {
+                    double nextZx = zx * zx - zy * zy + cx;
+                    zy = 2.0 * zx * zy + cy;
+                    zx = nextZx;
+                    iterations++;
+                    if (zx * zx + zy * zy > escapeRadiusSquared)
+                        break;
+                }
+            }
+        }
+        return iterations;
+    }
+
+    // Warms up, then times options.frames frames (or options.durationSeconds) of ComputeTask alone
+    BenchRun Run(VulkanManager& vulkanManager, const BenchOptions& options, const MandlebrotSettings& settings)
+    {
+        const uint32_t framesInFlight = vulkanManager.GetMaxFramesInFlight();
+        ComputeTask computeTask(vulkanManager.GetLogicalDevice(), vulkanManager.GetMemoryAllocator(), vulkanManager.GetPipelineCache(),
+            vulkanManager.GetGpuProfiler(), vulkanManager.GetImmediateSubmitContext(),
+            vulkanManager.GetComputeQueue(), vulkanManager.GetComputeQueueFamilyIndex(), framesInFlight,
+            options.width, options.height, settings);
+        vulkanManager.GetImmediateSubmitContext().SubmitAndWait();
+
+        std::unique_ptr<ReadbackRing> readbackRing;
+        if (options.readback)
+        {
+            readbackRing = std::make_unique<ReadbackRing>(vulkanManager.GetLogicalDevice(), vulkanManager.GetPhysicalDevice(),
+                vulkanManager.GetMemoryAllocator(), framesInFlight, options.width, options.height);
+            computeTask.SetReadbackRing(readbackRing.get());
+        }
+
+        // Only compute runs, a frame retires once it signaled COMPUTE_FINISHED
+        FrameRing frameRing(vulkanManager.GetLogicalDevice(), framesInFlight, COMPUTE_FINISHED);
+
+        GpuProfiler& profiler = vulkanManager.GetGpuProfiler();
+
+        BenchRun run{};
+        // A consumer would read frame.pixels here, the bench only counts what arrived
+        auto PollReadbacks = [&](uint64_t frameIndex, bool timed)
+        {
+            if (!readbackRing)
+                return;
+            readbackRing->Poll([&](const ReadbackFrame& frame)
+            {
+                if (!timed)
+                    return;
+                run.readbackFrames++;
+                run.readbackLatencyFrames += frameIndex - frame.frameIndex;
+            });
+        };
+        uint32_t lastSlot = 0;
+        auto RunFrame = [&](bool timed)
+        {
+            FrameRing::Frame frame = frameRing.BeginFrame();
+            if (frame.slotRetired)
+                profiler.Collect(frame.slot);
+            PollReadbacks(frame.index, timed);
+
+            auto hostBegin = std::chrono::steady_clock::now();
+            computeTask.Update((uint32_t)frame.index, frame.slot, frame.timeline.GetSemaphore(),
+                frame.timeline.GetTimelineValue(TimelineStages::COMPUTE_FINISHED), options.view);
+            if (timed)
+                run.hostWorkMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - hostBegin).count();
+            lastSlot = frame.slot;
+
+            frameRing.EndFrame();
+        };
+
+        for (uint64_t i = 0; i < options.warmupFrames; i++)
+            RunFrame(false);
+
+        vulkanManager.AreTheQueuesIdle();
+        for (uint32_t i = 0; i < framesInFlight; i++)
+            profiler.Collect(i);
+        profiler.ResetStatistics();
+        PollReadbacks(0, false);
+        const uint64_t warmupDroppedFrames = readbackRing ? readbackRing->GetDroppedFrameCount() : 0;
+
+        auto startTime = std::chrono::steady_clock::now();
+        auto KeepRunning = [&]()
+        {
+            if (options.durationSeconds > 0.0)
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() < options.durationSeconds;
+            return run.frames < options.frames;
+        };
+
+        while (KeepRunning())
+        {
+            RunFrame(true);
+            run.frames++;
+        }
+
+        vulkanManager.AreTheQueuesIdle();
+        run.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        PollReadbacks(frameRing.GetFrameIndex(), true);
+        if (readbackRing)
+        {
+            run.readbackDroppedFrames = readbackRing->GetDroppedFrameCount() - warmupDroppedFrames;
+            run.readbackHostCached = readbackRing->IsHostCached();
+        }
+        for (uint32_t i = 0; i < framesInFlight; i++)
+            profiler.Collect(i);
+
+        run.gpuSummary = profiler.GetSummary("Mandlebrot");
+        run.precision = computeTask.GetLastPrecision();
+        // The last submitted frame, slots that never ran a timed frame hold nothing
+        run.iteratedPixelFraction = computeTask.GetIteratedPixelFraction(lastSlot);
+        run.gpuRowShare = computeTask.GetGpuRowShare();
+        return run;
+    }
+
+    void WriteReport(const BenchOptions& options, const std::string& report)
+    {
+        if (options.outputPath.empty())
+        {
+            std::cout << report;
+        }
+        else
+        {
+            std::ofstream file(options.outputPath, std::ios::trunc);
+            file << report;
+        }
+    }
+
+    // Same loop as Run for CpuMandlebrot, each frame renders into one image. Mpixels/s per core is the total over the
+    // worker count, with SMT that's per hardware thread.
+    int RunCpu(const BenchOptions& options)
+    {
+        CpuMandlebrot renderer(options.cpuThreads, options.cpuSimdLevel);
+        const CpuMandlebrotParams params = CpuMandlebrotParams::FromView(options.view, options.width, options.height, options.settings);
+        std::vector<uint32_t> pixels((size_t)options.width * options.height);
+
+        if (ComputeTask::SelectPrecision(options.view, options.width, options.height) != MandlebrotPrecision::FLOAT)
+            std::cout << "The CPU renderer only iterates in float, this view needs more precision" << std::endl;
+
+        for (uint64_t i = 0; i < options.warmupFrames; i++)
+            renderer.Render(params, pixels.data());
+
+        uint64_t frames = 0;
+        auto startTime = std::chrono::steady_clock::now();
+        auto GetElapsedMs = [&]()
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        };
+        while (options.durationSeconds > 0.0 ? GetElapsedMs() < options.durationSeconds * 1000.0 : frames < options.frames)
+        {
+            renderer.Render(params, pixels.data());
+            frames++;
+        }
+        const double elapsedMs = GetElapsedMs();
+
+        const uint64_t pixelsPerFrame = (uint64_t)options.width * options.height;
+        const uint64_t iterationsPerFrame = CountIterationsPerFrame(options, MandlebrotPrecision::FLOAT);
+        const double elapsedSeconds = elapsedMs / 1000.0;
+        const double mpixelsPerSecond = pixelsPerFrame * frames / elapsedSeconds / 1e6;
+
+        std::ostringstream json;
+        json << "{\n"
+            << "  \"device\": \"cpu\",\n"
+            << "  \"simd\": \"" << CpuMandlebrot::GetSimdLevelName(renderer.GetSimdLevel()) << "\",\n"
+            << "  \"threads\": " << renderer.GetThreadCount() << ",\n"
+            << "  \"width\": " << options.width << ",\n"
+            << "  \"height\": " << options.height << ",\n"
+            << "  \"max_iterations\": " << options.settings.maxIterations << ",\n"
+            << "  \"zoom\": " << options.view.zoom << ",\n"
+            << "  \"center\": [" << std::setprecision(17) << options.view.centerX << ", " << options.view.centerY << std::setprecision(6) << "],\n"
+            << "  \"interior_culling\": " << (options.settings.interiorCulling ? "true" : "false") << ",\n"
+            << "  \"frames\": " << frames << ",\n"
+            << "  \"elapsed_ms\": " << elapsedMs << ",\n"
+            << "  \"iterations_per_frame\": " << iterationsPerFrame << ",\n"
+            << "  \"mpixels_per_s\": " << mpixelsPerSecond << ",\n"
+            << "  \"mpixels_per_s_per_core\": " << mpixelsPerSecond / renderer.GetThreadCount() << ",\n"
+            << "  \"giterations_per_s\": " << iterationsPerFrame * frames / elapsedSeconds / 1e9 << ",\n"
+            << "  \"wall_ms_per_frame\": " << elapsedMs / frames << "\n"
+            << "}\n";
+        WriteReport(options, json.str());
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options{};
+    if (!ParseArgs(argc, argv, options))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (options.cpu)
+        return RunCpu(options);
+
+    std::unique_ptr<VulkanManager> vulkanManager = std::make_unique<VulkanManager>(options.width, options.height, true, options.framesInFlight);
+    vulkanManager->Init(nullptr);
+
+    if (options.validate)
+    {
+        bool passed = false;
+        {
+            RegressionSuite suite(*vulkanManager, options.validation);
+            passed = suite.Run();
+            WriteReport(options, suite.GetReport());
+        }
+        vulkanManager->DeInit();
+        return passed ? 0 : 1;
+    }
+
+    VkPhysicalDeviceProperties deviceProp{};
+    vkGetPhysicalDeviceProperties(vulkanManager->GetPhysicalDevice(), &deviceProp);
+
+    if (options.autotune)
+        options.settings = KernelAutotuner(*vulkanManager, options.width, options.height).LoadOrTune(options.settings);
+
+    const auto& limits = deviceProp.limits;
+    if (options.settings.workgroupSizeX > limits.maxComputeWorkGroupSize[0] ||
+        options.settings.workgroupSizeY > limits.maxComputeWorkGroupSize[1] ||
+        options.settings.workgroupSizeX * options.settings.workgroupSizeY > limits.maxComputeWorkGroupInvocations)
+    {
+        std::cout << "Workgroup " << options.settings.workgroupSizeX << "x" << options.settings.workgroupSizeY
+            << " exceeds the device limits (" << limits.maxComputeWorkGroupInvocations << " invocations)" << std::endl;
+        vulkanManager->DeInit();
+        return 1;
+    }
+
+    // Culling comparison: the plain kernel first, then the culled one which the rest of the report is about
+    std::unique_ptr<BenchRun> baseline;
+    if (options.compareCulling)
+    {
+        MandlebrotSettings baselineSettings = options.settings;
+        baselineSettings.interiorCulling = false;
+        baseline = std::make_unique<BenchRun>(Run(*vulkanManager, options, baselineSettings));
+        options.settings.interiorCulling = true;
+    }
+    // Scheduling comparison, the grid kernel with otherwise the same settings
+    std::unique_ptr<BenchRun> gridBaseline;
+    if (options.compareGrid)
+    {
+        MandlebrotSettings gridSettings = options.settings;
+        gridSettings.kernel = MandlebrotKernel::GRID;
+        gridBaseline = std::make_unique<BenchRun>(Run(*vulkanManager, options, gridSettings));
+    }
+    const BenchRun run = Run(*vulkanManager, options, options.settings);
+
+    const uint32_t framesInFlight = vulkanManager->GetMaxFramesInFlight();
+    const GpuProfiler::ScopeSummary& gpuSummary = run.gpuSummary;
+    const uint64_t timedFrames = run.frames;
+    const double elapsedMs = run.elapsedMs;
+    const uint64_t pixelsPerFrame = (uint64_t)options.width * options.height;
+    const uint64_t iterationsPerFrame = CountIterationsPerFrame(options, run.precision);
+    const double elapsedSeconds = elapsedMs / 1000.0;
+
+    std::ostringstream json;
+    json << "{\n"
+        << "  \"device\": \"" << deviceProp.deviceName << "\",\n"
+        << "  \"width\": " << options.width << ",\n"
+        << "  \"height\": " << options.height << ",\n"
+        << "  \"max_iterations\": " << options.settings.maxIterations << ",\n"
+        << "  \"workgroup\": [" << options.settings.workgroupSizeX << ", " << options.settings.workgroupSizeY << "],\n"
+        << "  \"unroll\": " << options.settings.unroll << ",\n"
+        << "  \"frames_in_flight\": " << framesInFlight << ",\n"
+        << "  \"zoom\": " << options.view.zoom << ",\n"
+        << "  \"center\": [" << std::setprecision(17) << options.view.centerX << ", " << options.view.centerY << std::setprecision(6) << "],\n"
+        << "  \"precision\": \"" << ComputeTask::GetPrecisionName(run.precision) << "\",\n"
+        << "  \"interior_culling\": " << (options.settings.interiorCulling ? "true" : "false") << ",\n"
+        << "  \"kernel\": \"" << ComputeTask::GetKernelName(options.settings.kernel) << "\",\n"
+        << "  \"iterated_pixel_fraction\": " << run.iteratedPixelFraction << ",\n"
+        << "  \"hybrid\": " << (options.settings.hybridCpu ? "true" : "false") << ",\n"
+        << "  \"gpu_row_share\": " << run.gpuRowShare << ",\n"
+        << "  \"readback\": " << (options.readback ? "true" : "false") << ",\n"
+        << "  \"readback_frames\": " << run.readbackFrames << ",\n"
+        << "  \"readback_dropped_frames\": " << run.readbackDroppedFrames << ",\n"
+        << "  \"readback_latency_frames\": " << (run.readbackFrames > 0 ? (double)run.readbackLatencyFrames / run.readbackFrames : 0.0) << ",\n"
+        << "  \"readback_host_cached\": " << (run.readbackHostCached ? "true" : "false") << ",\n"
+        << "  \"frames\": " << timedFrames << ",\n"
+        << "  \"elapsed_ms\": " << elapsedMs << ",\n"
+        << "  \"iterations_per_frame\": " << iterationsPerFrame << ",\n"
+        << "  \"mpixels_per_s\": " << pixelsPerFrame * timedFrames / elapsedSeconds / 1e6 << ",\n"
+        << "  \"giterations_per_s\": " << iterationsPerFrame * timedFrames / elapsedSeconds / 1e9 << ",\n"
+        << "  \"wall_ms_per_frame\": " << elapsedMs / timedFrames << ",\n"
+        << "  \"cpu_ms_per_frame\": " << run.hostWorkMs / timedFrames << ",\n"
+        << "  \"gpu_ms_per_frame\": { \"min\": " << gpuSummary.minMs << ", \"avg\": " << gpuSummary.avgMs
+        << ", \"p99\": " << gpuSummary.p99Ms << ", \"samples\": " << gpuSummary.count << " }";
+    if (baseline)
+    {
+        json << ",\n"
+            << "  \"baseline_wall_ms_per_frame\": " << baseline->elapsedMs / baseline->frames << ",\n"
+            << "  \"baseline_gpu_ms_per_frame\": " << baseline->gpuSummary.avgMs << ",\n"
+            << "  \"interior_culling_speedup\": " << baseline->GetMsPerFrame() / run.GetMsPerFrame();
+    }
+    if (gridBaseline)
+    {
+        json << ",\n"
+            << "  \"grid_wall_ms_per_frame\": " << gridBaseline->elapsedMs / gridBaseline->frames << ",\n"
+            << "  \"grid_gpu_ms_per_frame\": " << gridBaseline->gpuSummary.avgMs << ",\n"
+            << "  \"kernel_speedup\": " << gridBaseline->GetMsPerFrame() / run.GetMsPerFrame();
+    }
+    json << "\n}\n";
+    WriteReport(options, json.str());
+
+    vulkanManager->DeInit();
+    return 0;
+}
@@ -0,0 +1,1113 @@
+#include "ComputeTask.h"
+#include "CpuMandlebrot.h"
+#include "EmbeddedShaders.h"
+#include "FrameStats.h"
+#include "ReadbackRing.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    // A pixel has to span at least 2^-17 of the view's magnitude in float, about 64 ulps, before the float kernel
+    // starts showing blocks. Past 2^-40 even df64 runs out of bits, which needs perturbation instead.
+    constexpr double FLOAT_MIN_RELATIVE_STEP = 1.0 / (1 << 17);
+    constexpr double DF64_MIN_RELATIVE_STEP = 1.0 / (1ull << 40);
+
+    // A stale orbit (the new one is still being computed) is only used while the view center stays this many
+    // pixels around its reference, rebasing copes with that but the deltas would lose precision further out
+    constexpr double MAX_REFERENCE_DISTANCE_PIXELS = 65536.0;
+
+    // Persistent threads: core Vulkan can't tell how many workgroups the device keeps resident, launch enough
+    // invocations to fill a large desktop GPU. On smaller ones the surplus workgroups run once the first ones
+    // retire and find the queue (nearly) drained, which costs next to nothing.
+    constexpr uint32_t PERSISTENT_INVOCATIONS = 65536;
+
+    // Weight of the newest throughput sample of the hybrid split, the rest is history. Damps the split bouncing
+    // around when the boundary moves across regions of different cost.
+    constexpr double HYBRID_SAMPLE_WEIGHT = 0.5;
+
+    void SplitDouble(double value, float (&pair)[2])
+    {
+        pair[0] = (float)value;
+        pair[1] = (float)(value - (double)pair[0]);
+    }
+}
+
+ComputeTask::ComputeTask(const VkDevice& device, MemoryAllocator& allocator, const VkPipelineCache& pipelineCache, GpuProfiler& profiler,
+    ImmediateSubmitContext& immediateContext, const VkQueue& computeQueue, uint32_t queueFamilyIndex,
+    uint32_t maxFrameInFlight, uint32_t imageWidth, uint32_t imageHeight, const MandlebrotSettings& settings) :
+    m_computeQueue(computeQueue), m_device(device), m_allocator(allocator), m_profiler(profiler), m_queueFamilyIndex(queueFamilyIndex),
+    m_imageWidth(imageWidth), m_imageHeight(imageHeight),
+    m_maxFrameInFlights(maxFrameInFlight), m_settings(settings)
+{
+    VkCommandPoolCreateInfo createInfo{};
+    createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    createInfo.queueFamilyIndex = queueFamilyIndex;
+    createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+
+    ErrorCheck(vkCreateCommandPool(device, &createInfo, nullptr, &m_commandPool));
+
+    m_commandBuffers.resize(maxFrameInFlight);
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.commandBufferCount = maxFrameInFlight;
+    alloc_info.commandPool = m_commandPool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+
+    ErrorCheck(vkAllocateCommandBuffers(device, &alloc_info, &m_commandBuffers[0]));
+
+    // Storage images, written by the compute shader (and hybrid rendering's copies) and sampled by the graphics task in GENERAL layout
+    m_storageImageViews.resize(maxFrameInFlight);
+    for (uint32_t i = 0; i < maxFrameInFlight; ++i)
+    {
+        auto[image, memory] = CreateImage(device, allocator, imageWidth, imageHeight, VK_FORMAT_R8G8B8A8_UNORM,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+        m_storageImages.push_back(std::move(image));
+        m_storageImageMemory.push_back(std::move(memory));
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY };
+        viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        viewInfo.image = m_storageImages[i];
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+        ErrorCheck(vkCreateImageView(device, &viewInfo, nullptr, &m_storageImageViews[i]));
+    }
+
+    ChangeImageLayout(immediateContext.Begin(), m_storageImages, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+    CreateOrbitBuffers();
+    if (m_settings.precision == MandlebrotPrecision::AUTO || m_settings.precision == MandlebrotPrecision::PERTURBATION)
+        m_referenceOrbits = std::make_unique<ReferenceOrbitBuilder>();
+
+    // Descriptors, binding 0 is the target image, binding 1 the reference orbit
+    {
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorCount = 1;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorCount = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.bindingCount = (uint32_t)bindings.size();
+        layoutInfo.pBindings = bindings.data();
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+
+        ErrorCheck(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout));
+
+        std::array<VkDescriptorPoolSize, 2> poolSizes{};
+        poolSizes[0].descriptorCount = maxFrameInFlight;
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        poolSizes[1].descriptorCount = maxFrameInFlight;
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.maxSets = maxFrameInFlight;
+        poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+
+        ErrorCheck(vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool));
+
+        std::vector<VkDescriptorSetLayout> layouts(maxFrameInFlight, m_descriptorSetLayout);
+        m_descriptorSets.resize(maxFrameInFlight);
+
+        VkDescriptorSetAllocateInfo setAllocInfo{};
+        setAllocInfo.descriptorPool = m_descriptorPool;
+        setAllocInfo.descriptorSetCount = maxFrameInFlight;
+        setAllocInfo.pSetLayouts = layouts.data();
+        setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+
+        ErrorCheck(vkAllocateDescriptorSets(device, &setAllocInfo, m_descriptorSets.data()));
+
+        for (uint32_t i = 0; i < maxFrameInFlight; i++)
+        {
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            imageInfo.imageView = m_storageImageViews[i];
+
+            VkWriteDescriptorSet write{};
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            write.dstBinding = 0;
+            write.dstSet = m_descriptorSets[i];
+            write.pImageInfo = &imageInfo;
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+
+            vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        }
+        WriteOrbitDescriptors(m_descriptorSets);
+    }
+
+    if (m_settings.kernel != MandlebrotKernel::GRID)
+        CreateTileResources();
+    if (m_settings.hybridCpu && m_settings.kernel == MandlebrotKernel::GRID)
+        CreateHybridResources();
+
+    // Pipeline, set 1 only for the kernels which schedule their own tiles
+    std::array<VkDescriptorSetLayout, 2> setLayouts{ m_descriptorSetLayout, m_tileDescriptorSetLayout };
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.setLayoutCount = m_settings.kernel != MandlebrotKernel::GRID ? 2 : 1;
+    pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+    ErrorCheck(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));
+
+    switch (m_settings.kernel)
+    {
+    case MandlebrotKernel::GRID:
+        CreatePipelines(pipelineCache, EmbeddedShaders::Mandlebrot, sizeof(EmbeddedShaders::Mandlebrot), m_shaderModule, m_pipelines);
+        break;
+    case MandlebrotKernel::PERSISTENT:
+        CreatePipelines(pipelineCache, EmbeddedShaders::MandlebrotPersistent, sizeof(EmbeddedShaders::MandlebrotPersistent),
+            m_shaderModule, m_pipelines);
+        break;
+    case MandlebrotKernel::MARIANI_SILVER:
+        CreatePipelines(pipelineCache, EmbeddedShaders::MandlebrotTiles, sizeof(EmbeddedShaders::MandlebrotTiles), m_shaderModule, m_pipelines);
+        break;
+    }
+}
+
+void ComputeTask::CreatePipelines(const VkPipelineCache& pipelineCache, const uint32_t* code, size_t codeSize,
+    VkShaderModule& shaderModule, std::array<VkPipeline, 3>& pipelines)
+{
+    shaderModule = std::get<0>(CreateShaderModule(m_device, code, codeSize, VkShaderStageFlagBits::VK_SHADER_STAGE_COMPUTE_BIT));
+
+    for (MandlebrotPrecision precision : { MandlebrotPrecision::FLOAT, MandlebrotPrecision::DF64, MandlebrotPrecision::PERTURBATION })
+    {
+        if (m_settings.precision == MandlebrotPrecision::AUTO || m_settings.precision == precision)
+            pipelines[(uint32_t)precision] = CreatePipeline(pipelineCache, shaderModule, precision);
+    }
+}
+
+VkPipeline ComputeTask::CreatePipeline(const VkPipelineCache& pipelineCache, const VkShaderModule& shaderModule, MandlebrotPrecision precision)
+{
+    VkPipelineShaderStageCreateInfo shaderStage{};
+    shaderStage.module = shaderModule;
+    shaderStage.pName = "main";
+    shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+
+    struct SpecializationData
+    {
+        uint32_t workgroupSizeX;
+        uint32_t workgroupSizeY;
+        uint32_t unroll;
+        uint32_t precision;
+        VkBool32 interiorCulling;
+    } specializationData{ m_settings.workgroupSizeX, m_settings.workgroupSizeY, m_settings.unroll, (uint32_t)precision,
+        m_settings.interiorCulling ? VK_TRUE : VK_FALSE };
+
+    // local_size_x_id / local_size_y_id / UNROLL / PRECISION / INTERIOR_CULLING
+    std::array<VkSpecializationMapEntry, 5> specializationEntries{};
+    specializationEntries[0].constantID = 0;
+    specializationEntries[0].offset = offsetof(SpecializationData, workgroupSizeX);
+    specializationEntries[0].size = sizeof(uint32_t);
+    specializationEntries[1].constantID = 1;
+    specializationEntries[1].offset = offsetof(SpecializationData, workgroupSizeY);
+    specializationEntries[1].size = sizeof(uint32_t);
+    specializationEntries[2].constantID = 2;
+    specializationEntries[2].offset = offsetof(SpecializationData, unroll);
+    specializationEntries[2].size = sizeof(uint32_t);
+    specializationEntries[3].constantID = 3;
+    specializationEntries[3].offset = offsetof(SpecializationData, precision);
+    specializationEntries[3].size = sizeof(uint32_t);
+    specializationEntries[4].constantID = 4;
+    specializationEntries[4].offset = offsetof(SpecializationData, interiorCulling);
+    specializationEntries[4].size = sizeof(VkBool32);
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.dataSize = sizeof(SpecializationData);
+    specializationInfo.mapEntryCount = (uint32_t)specializationEntries.size();
+    specializationInfo.pData = &specializationData;
+    specializationInfo.pMapEntries = specializationEntries.data();
+    shaderStage.pSpecializationInfo = &specializationInfo;
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo{};
+    computePipelineCreateInfo.layout = m_pipelineLayout;
+    computePipelineCreateInfo.stage = shaderStage;
+    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    ErrorCheck(vkCreateComputePipelines(m_device, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &pipeline));
+    return pipeline;
+}
+
+void ComputeTask::EnableSwapchainTargets(const VkPipelineCache& pipelineCache)
+{
+    if (m_presentShaderModule != VK_NULL_HANDLE)
+        return;
+
+    switch (m_settings.kernel)
+    {
+    case MandlebrotKernel::GRID:
+        CreatePipelines(pipelineCache, EmbeddedShaders::MandlebrotPresent, sizeof(EmbeddedShaders::MandlebrotPresent),
+            m_presentShaderModule, m_presentPipelines);
+        break;
+    case MandlebrotKernel::PERSISTENT:
+        CreatePipelines(pipelineCache, EmbeddedShaders::MandlebrotPersistentPresent, sizeof(EmbeddedShaders::MandlebrotPersistentPresent),
+            m_presentShaderModule, m_presentPipelines);
+        break;
+    case MandlebrotKernel::MARIANI_SILVER:
+        CreatePipelines(pipelineCache, EmbeddedShaders::MandlebrotTilesPresent, sizeof(EmbeddedShaders::MandlebrotTilesPresent),
+            m_presentShaderModule, m_presentPipelines);
+        break;
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].descriptorCount = m_maxFrameInFlights;
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = m_maxFrameInFlights;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.maxSets = m_maxFrameInFlights;
+    poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+
+    ErrorCheck(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_presentDescriptorPool));
+
+    std::vector<VkDescriptorSetLayout> layouts(m_maxFrameInFlights, m_descriptorSetLayout);
+    m_presentDescriptorSets.resize(m_maxFrameInFlights);
+
+    VkDescriptorSetAllocateInfo setAllocInfo{};
+    setAllocInfo.descriptorPool = m_presentDescriptorPool;
+    setAllocInfo.descriptorSetCount = m_maxFrameInFlights;
+    setAllocInfo.pSetLayouts = layouts.data();
+    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+
+    ErrorCheck(vkAllocateDescriptorSets(m_device, &setAllocInfo, m_presentDescriptorSets.data()));
+    WriteOrbitDescriptors(m_presentDescriptorSets);
+}
+
+void ComputeTask::CreateOrbitBuffers()
+{
+    // Z(0) ... Z(maxIterations) at most
+    const size_t bufferSize = ((size_t)m_settings.maxIterations + 1) * 2 * sizeof(float);
+    for (uint32_t i = 0; i < m_maxFrameInFlights; i++)
+    {
+        auto[buffer, memory] = CreateBufferAndMemory(m_device, m_allocator, bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        m_orbitBuffers.push_back(buffer);
+        m_orbitBufferMemory.push_back(memory);
+    }
+    m_orbitBufferVersions.resize(m_maxFrameInFlights, 0);
+}
+
+void ComputeTask::WriteOrbitDescriptors(const std::vector<VkDescriptorSet>& descriptorSets)
+{
+    for (uint32_t i = 0; i < (uint32_t)descriptorSets.size(); i++)
+    {
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = m_orbitBuffers[i];
+        bufferInfo.offset = 0;
+        bufferInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet write{};
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.dstBinding = 1;
+        write.dstSet = descriptorSets[i];
+        write.pBufferInfo = &bufferInfo;
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+
+        vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    }
+}
+
+void ComputeTask::CreateTileResources()
+{
+    const bool marianiSilver = m_settings.kernel == MandlebrotKernel::MARIANI_SILVER;
+
+    // Control buffer: reset by a transfer every frame and hammered by atomics, so device local. Mariani-Silver's also
+    // holds indirect arguments, its pixel count is copied to the host visible stats buffer for the benchmark.
+    for (uint32_t i = 0; i < m_maxFrameInFlights; i++)
+    {
+        auto[controlBuffer, controlMemory] = CreateBufferAndMemory(m_device, m_allocator, marianiSilver ? sizeof(TileControl) : sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_tileControlBuffers.push_back(controlBuffer);
+        m_tileControlMemory.push_back(controlMemory);
+
+        if (!marianiSilver)
+            continue;
+
+        auto[listBuffer, listMemory] = CreateBufferAndMemory(m_device, m_allocator,
+            (VkDeviceSize)(TILE_LEVELS - 1) * TILE_LIST_CAPACITY * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_tileListBuffers.push_back(listBuffer);
+        m_tileListMemory.push_back(listMemory);
+
+        auto[statsBuffer, statsMemory] = CreateBufferAndMemory(m_device, m_allocator, sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        m_tileStatsBuffers.push_back(statsBuffer);
+        m_tileStatsMemory.push_back(statsMemory);
+    }
+    m_tilePixelCounts.resize(m_maxFrameInFlights, 0);
+
+    if (m_settings.kernel == MandlebrotKernel::PERSISTENT)
+    {
+        m_persistentWorkgroups = m_settings.persistentWorkgroups;
+        if (m_persistentWorkgroups == 0)
+            m_persistentWorkgroups = std::max(PERSISTENT_INVOCATIONS / (m_settings.workgroupSizeX * m_settings.workgroupSizeY), 1u);
+        // maxComputeWorkGroupCount[0] is at least 65535 everywhere
+        m_persistentWorkgroups = std::min(m_persistentWorkgroups, 65535u);
+    }
+
+    const uint32_t bindingCount = marianiSilver ? 2 : 1;
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    for (uint32_t binding = 0; binding < bindingCount; binding++)
+    {
+        bindings[binding].binding = binding;
+        bindings[binding].descriptorCount = 1;
+        bindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.bindingCount = bindingCount;
+    layoutInfo.pBindings = bindings.data();
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+
+    ErrorCheck(vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_tileDescriptorSetLayout));
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.descriptorCount = bindingCount * m_maxFrameInFlights;
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.maxSets = m_maxFrameInFlights;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+
+    ErrorCheck(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_tileDescriptorPool));
+
+    std::vector<VkDescriptorSetLayout> layouts(m_maxFrameInFlights, m_tileDescriptorSetLayout);
+    m_tileDescriptorSets.resize(m_maxFrameInFlights);
+
+    VkDescriptorSetAllocateInfo setAllocInfo{};
+    setAllocInfo.descriptorPool = m_tileDescriptorPool;
+    setAllocInfo.descriptorSetCount = m_maxFrameInFlights;
+    setAllocInfo.pSetLayouts = layouts.data();
+    setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+
+    ErrorCheck(vkAllocateDescriptorSets(m_device, &setAllocInfo, m_tileDescriptorSets.data()));
+
+    for (uint32_t i = 0; i < m_maxFrameInFlights; i++)
+    {
+        std::array<VkDescriptorBufferInfo, 2> bufferInfos{};
+        bufferInfos[0].buffer = m_tileControlBuffers[i];
+        bufferInfos[0].range = VK_WHOLE_SIZE;
+        if (marianiSilver)
+        {
+            bufferInfos[1].buffer = m_tileListBuffers[i];
+            bufferInfos[1].range = VK_WHOLE_SIZE;
+        }
+
+        VkWriteDescriptorSet write{};
+        write.descriptorCount = bindingCount;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.dstBinding = 0;
+        write.dstSet = m_tileDescriptorSets[i];
+        write.pBufferInfo = bufferInfos.data();
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+
+        vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    }
+}
+
+void ComputeTask::CreateHybridResources()
+{
+    m_cpuRenderer = std::make_unique<CpuMandlebrot>(m_settings.cpuThreads);
+
+    m_uploadCommandBuffers.resize(m_maxFrameInFlights);
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.commandBufferCount = m_maxFrameInFlights;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+
+    ErrorCheck(vkAllocateCommandBuffers(m_device, &allocInfo, &m_uploadCommandBuffers[0]));
+
+    // Room for the whole image, the split can land anywhere
+    const VkDeviceSize bufferSize = (VkDeviceSize)m_imageWidth * m_imageHeight * sizeof(uint32_t);
+    for (uint32_t i = 0; i < m_maxFrameInFlights; i++)
+    {
+        auto[buffer, memory] = CreateBufferAndMemory(m_device, m_allocator, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        m_stagingBuffers.push_back(buffer);
+        m_stagingBufferMemory.push_back(memory);
+    }
+    m_hybridSplits.resize(m_maxFrameInFlights);
+
+    std::cout << "Hybrid rendering : " << m_cpuRenderer->GetThreadCount() << " CPU threads, "
+        << CpuMandlebrot::GetSimdLevelName(m_cpuRenderer->GetSimdLevel()) << std::endl;
+}
+
+ComputeTask::~ComputeTask()
+{
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    for (VkPipeline pipeline : m_pipelines)
+        vkDestroyPipeline(m_device, pipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyShaderModule(m_device, m_shaderModule, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    if (m_presentShaderModule != VK_NULL_HANDLE)
+    {
+        for (VkPipeline pipeline : m_presentPipelines)
+            vkDestroyPipeline(m_device, pipeline, nullptr);
+        vkDestroyShaderModule(m_device, m_presentShaderModule, nullptr);
+        vkDestroyDescriptorPool(m_device, m_presentDescriptorPool, nullptr);
+    }
+    vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+
+    if (m_tileDescriptorSetLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorPool(m_device, m_tileDescriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(m_device, m_tileDescriptorSetLayout, nullptr);
+    }
+    for (uint32_t i = 0; i < m_tileControlBuffers.size(); i++)
+    {
+        vkDestroyBuffer(m_device, m_tileControlBuffers[i], nullptr);
+        m_allocator.Free(m_tileControlMemory[i]);
+    }
+    for (uint32_t i = 0; i < m_tileListBuffers.size(); i++)
+    {
+        vkDestroyBuffer(m_device, m_tileListBuffers[i], nullptr);
+        m_allocator.Free(m_tileListMemory[i]);
+    }
+    for (uint32_t i = 0; i < m_tileStatsBuffers.size(); i++)
+    {
+        vkDestroyBuffer(m_device, m_tileStatsBuffers[i], nullptr);
+        m_allocator.Free(m_tileStatsMemory[i]);
+    }
+    for (uint32_t i = 0; i < m_stagingBuffers.size(); i++)
+    {
+        vkDestroyBuffer(m_device, m_stagingBuffers[i], nullptr);
+        m_allocator.Free(m_stagingBufferMemory[i]);
+    }
+
+    m_referenceOrbits.reset();
+    for (uint32_t i = 0; i < m_orbitBuffers.size(); i++)
+    {
+        vkDestroyBuffer(m_device, m_orbitBuffers[i], nullptr);
+        m_allocator.Free(m_orbitBufferMemory[i]);
+    }
+
+    for (uint32_t i = 0; i < m_storageImages.size(); i++)
+    {
+        vkDestroyImageView(m_device, m_storageImageViews[i], nullptr);
+        m_allocator.Free(m_storageImageMemory[i]);
+        vkDestroyImage(m_device, m_storageImages[i], nullptr);
+    }
+}
+
+void ComputeTask::BuildCommandBuffers(const uint32_t& frameInFlight, const DispatchTarget& target, const PushConstants& pushConstants,
+    uint32_t gpuRows)
+{
+    ErrorCheck(vkResetCommandBuffer(m_commandBuffers[frameInFlight], 0));
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    ErrorCheck(vkBeginCommandBuffer(m_commandBuffers[frameInFlight], &beginInfo));
+
+    VkImageMemoryBarrier2 swapchainBarrier{};
+    swapchainBarrier.image = target.swapchainImage;
+    swapchainBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    swapchainBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    swapchainBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    swapchainBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.imageMemoryBarrierCount = 1;
+    dependencyInfo.pImageMemoryBarriers = &swapchainBarrier;
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+
+    if (target.swapchainImage != VK_NULL_HANDLE)
+    {
+        // Every pixel gets overwritten, the previous content is discarded. The acquire semaphore is waited on at
+        // the compute stage, which the barrier's source stage chains with.
+        swapchainBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        swapchainBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+        swapchainBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        swapchainBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        swapchainBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        swapchainBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        vkCmdPipelineBarrier2(m_commandBuffers[frameInFlight], &dependencyInfo);
+    }
+
+    {
+        GpuProfileScope profileScope(m_profiler, m_commandBuffers[frameInFlight], frameInFlight, "Mandlebrot");
+
+        vkCmdBindPipeline(m_commandBuffers[frameInFlight], VK_PIPELINE_BIND_POINT_COMPUTE, target.pipeline);
+        vkCmdBindDescriptorSets(m_commandBuffers[frameInFlight], VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+            0, 1, &target.descriptorSet, 0, nullptr);
+        vkCmdPushConstants(m_commandBuffers[frameInFlight], m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+            0, sizeof(PushConstants), &pushConstants);
+
+        switch (m_settings.kernel)
+        {
+        case MandlebrotKernel::GRID:
+            // A split frame ends on a workgroup row, the CPU rows below are never touched
+            if (gpuRows > 0)
+                vkCmdDispatch(m_commandBuffers[frameInFlight],
+                    (pushConstants.width + m_settings.workgroupSizeX - 1) / m_settings.workgroupSizeX,
+                    (gpuRows + m_settings.workgroupSizeY - 1) / m_settings.workgroupSizeY, 1);
+            break;
+        case MandlebrotKernel::PERSISTENT:
+            RecordPersistentDispatch(frameInFlight, pushConstants);
+            break;
+        case MandlebrotKernel::MARIANI_SILVER:
+            RecordTileDispatches(frameInFlight, pushConstants);
+            break;
+        }
+    }
+
+    if (target.swapchainImage != VK_NULL_HANDLE)
+    {
+        // The present side waits on the timeline signal, which covers everything up to ALL_COMMANDS
+        swapchainBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        swapchainBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        swapchainBarrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+        swapchainBarrier.dstAccessMask = VK_ACCESS_2_NONE;
+        swapchainBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        swapchainBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        vkCmdPipelineBarrier2(m_commandBuffers[frameInFlight], &dependencyInfo);
+    }
+    else if (gpuRows == pushConstants.height)
+    {
+        // A split frame finishes the image after the copy of the CPU rows instead, see RenderCpuRows
+        RecordStorageImageEpilogue(m_commandBuffers[frameInFlight], frameInFlight,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+    }
+
+    ErrorCheck(vkEndCommandBuffer(m_commandBuffers[frameInFlight]));
+}
+
+void ComputeTask::RecordStorageImageEpilogue(const VkCommandBuffer& commandBuffer, const uint32_t& frameInFlight,
+    VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask)
+{
+    if (m_readbackRing != nullptr)
+    {
+        m_readbackRing->RecordCopy(commandBuffer, frameInFlight, m_storageImages[frameInFlight], srcStageMask, srcAccessMask);
+        // The release must not overtake the copy's reads
+        srcStageMask |= VK_PIPELINE_STAGE_2_COPY_BIT;
+    }
+
+    if (IsReleasingStorageImages())
+        RecordStorageImageRelease(commandBuffer, frameInFlight, srcStageMask, srcAccessMask);
+}
+
+void ComputeTask::RecordStorageImageRelease(const VkCommandBuffer& commandBuffer, const uint32_t& frameInFlight,
+    VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask)
+{
+    // Release half of the ownership transfer, the graphics task records the acquire. Destination stage and
+    // access are ignored for a release.
+    VkImageMemoryBarrier2 releaseBarrier{};
+    releaseBarrier.image = m_storageImages[frameInFlight];
+    releaseBarrier.srcQueueFamilyIndex = m_queueFamilyIndex;
+    releaseBarrier.dstQueueFamilyIndex = m_releaseQueueFamily;
+    releaseBarrier.srcStageMask = srcStageMask;
+    releaseBarrier.srcAccessMask = srcAccessMask;
+    releaseBarrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+    releaseBarrier.dstAccessMask = VK_ACCESS_2_NONE;
+    releaseBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    releaseBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    releaseBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    releaseBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.imageMemoryBarrierCount = 1;
+    dependencyInfo.pImageMemoryBarriers = &releaseBarrier;
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+void ComputeTask::RecordPersistentDispatch(const uint32_t& frameInFlight, const PushConstants& pushConstants)
+{
+    VkCommandBuffer commandBuffer = m_commandBuffers[frameInFlight];
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+        1, 1, &m_tileDescriptorSets[frameInFlight], 0, nullptr);
+    vkCmdFillBuffer(commandBuffer, m_tileControlBuffers[frameInFlight], 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier2 memoryBarrier{};
+    memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    memoryBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.memoryBarrierCount = 1;
+    dependencyInfo.pMemoryBarriers = &memoryBarrier;
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+    // No more workgroups than tiles, small targets would only launch idle ones
+    const uint32_t tileCount = ((pushConstants.width + m_settings.workgroupSizeX - 1) / m_settings.workgroupSizeX) *
+        ((pushConstants.height + m_settings.workgroupSizeY - 1) / m_settings.workgroupSizeY);
+    vkCmdDispatch(commandBuffer, std::min(m_persistentWorkgroups, tileCount), 1, 1);
+}
+
+void ComputeTask::RecordTileDispatches(const uint32_t& frameInFlight, const PushConstants& pushConstants)
+{
+    VkCommandBuffer commandBuffer = m_commandBuffers[frameInFlight];
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+        1, 1, &m_tileDescriptorSets[frameInFlight], 0, nullptr);
+
+    // Empty lists, the workgroups grow x as they append. y and z stay 1.
+    TileControl control{};
+    for (TileDispatch& dispatch : control.dispatches)
+        dispatch.command = { 0, 1, 1 };
+    vkCmdUpdateBuffer(commandBuffer, m_tileControlBuffers[frameInFlight], 0, sizeof(TileControl), &control);
+    m_tilePixelCounts[frameInFlight] = pushConstants.width * pushConstants.height;
+
+    VkMemoryBarrier2 memoryBarrier{};
+    memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    memoryBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.memoryBarrierCount = 1;
+    dependencyInfo.pMemoryBarriers = &memoryBarrier;
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+    PushConstants levelConstants = pushConstants;
+    for (uint32_t level = 0; level < TILE_LEVELS; level++)
+    {
+        levelConstants.tileLevel = level;
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &levelConstants);
+
+        if (level == 0)
+        {
+            vkCmdDispatch(commandBuffer, (pushConstants.width + TILE_SIZE - 1) / TILE_SIZE, (pushConstants.height + TILE_SIZE - 1) / TILE_SIZE, 1);
+        }
+        else
+        {
+            vkCmdDispatchIndirect(commandBuffer, m_tileControlBuffers[frameInFlight],
+                offsetof(TileControl, dispatches) + level * sizeof(TileDispatch));
+        }
+
+        // The next level reads the list and its dispatch size this one appended, and may rewrite border pixels
+        // (with the same color) this one wrote
+        memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        memoryBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        memoryBarrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+            VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        if (level + 1 < TILE_LEVELS)
+            vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    }
+
+    // Pixel count of the whole frame to the host, the timeline signal covers the copy (ALL_COMMANDS in Update)
+    memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    memoryBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+    VkBufferCopy region{};
+    region.srcOffset = offsetof(TileControl, iteratedPixels);
+    region.size = sizeof(uint32_t);
+    vkCmdCopyBuffer(commandBuffer, m_tileControlBuffers[frameInFlight], m_tileStatsBuffers[frameInFlight], 1, &region);
+
+    VkBufferMemoryBarrier2 hostBarrier{};
+    hostBarrier.buffer = m_tileStatsBuffers[frameInFlight];
+    hostBarrier.size = VK_WHOLE_SIZE;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    hostBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    hostBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+
+    dependencyInfo.memoryBarrierCount = 0;
+    dependencyInfo.pMemoryBarriers = nullptr;
+    dependencyInfo.bufferMemoryBarrierCount = 1;
+    dependencyInfo.pBufferMemoryBarriers = &hostBarrier;
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+void ComputeTask::Submit(const VkCommandBuffer& commandBuffer, const VkSemaphoreSubmitInfo* waitInfo, const VkSemaphoreSubmitInfo* signalInfo)
+{
+    VkCommandBufferSubmitInfo bufInfo{};
+    bufInfo.commandBuffer = commandBuffer;
+    bufInfo.deviceMask = 0;
+    bufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+
+    VkSubmitInfo2 submitInfo{};
+    submitInfo.commandBufferInfoCount = 1;
+    submitInfo.pCommandBufferInfos = &bufInfo;
+    submitInfo.pSignalSemaphoreInfos = signalInfo;
+    submitInfo.signalSemaphoreInfoCount = signalInfo != nullptr ? 1 : 0;
+    submitInfo.pWaitSemaphoreInfos = waitInfo;
+    submitInfo.waitSemaphoreInfoCount = waitInfo != nullptr ? 1 : 0;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+
+    FRAME_STATS_SCOPE(SUBMIT);
+    ErrorCheck(vkQueueSubmit2(m_computeQueue, 1, &submitInfo, VK_NULL_HANDLE));
+}
+
+void ComputeTask::Update(const uint32_t& frameIndex, const uint32_t& frameInFlight,
+    const VkSemaphore& timelineSem, uint64_t signalValue, const MandlebrotView& view)
+{
+    PushConstants pushConstants{};
+    MandlebrotPrecision precision = PreparePushConstants(view, frameInFlight, m_imageWidth, m_imageHeight, pushConstants);
+
+    // The CPU renderer only iterates in float
+    const uint32_t gpuRows = m_cpuRenderer && precision == MandlebrotPrecision::FLOAT ? SelectGpuRows(frameInFlight) : m_imageHeight;
+    {
+        FRAME_STATS_SCOPE(RECORD);
+        BuildCommandBuffers(frameInFlight, { m_pipelines[(uint32_t)precision], m_descriptorSets[frameInFlight], VK_NULL_HANDLE }, pushConstants,
+            gpuRows);
+    }
+
+    // No GPU wait required, the host already waited for this frame in flight's previous SAFE_TO_PRESENT
+    // which covers the graphics task sampling the storage image.
+    // A release barrier or a readback / tile stats copy has to be covered by the signal as well, hence ALL_COMMANDS then.
+    const bool copiesAfterDispatch = IsReleasingStorageImages() || m_readbackRing != nullptr ||
+        m_settings.kernel == MandlebrotKernel::MARIANI_SILVER;
+    VkSemaphoreSubmitInfo signalInfo
+    { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, timelineSem, signalValue,
+        copiesAfterDispatch ? VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, 0 };
+
+    if (gpuRows == m_imageHeight)
+    {
+        Submit(m_commandBuffers[frameInFlight], nullptr, &signalInfo);
+        if (m_readbackRing != nullptr)
+            m_readbackRing->OnSubmitted(frameInFlight, frameIndex, timelineSem, signalValue);
+        return;
+    }
+
+    // The GPU starts on its rows right away and the CPU renders the rest meanwhile. Submission order puts the copy
+    // after the dispatch, which never writes the copied rows, and the signal covers both.
+    Submit(m_commandBuffers[frameInFlight], nullptr, nullptr);
+    RenderCpuRows(frameInFlight, view, gpuRows);
+
+    signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    Submit(m_uploadCommandBuffers[frameInFlight], nullptr, &signalInfo);
+    if (m_readbackRing != nullptr)
+        m_readbackRing->OnSubmitted(frameInFlight, frameIndex, timelineSem, signalValue);
+}
+
+uint32_t ComputeTask::SelectGpuRows(const uint32_t& frameInFlight)
+{
+    auto Blend = [](double history, double sample)
+    {
+        return history > 0.0 ? history + HYBRID_SAMPLE_WEIGHT * (sample - history) : sample;
+    };
+
+    // The previous frame of this slot retired and its timestamps were collected before this Update, the sample is
+    // that frame's and matches last.gpuRows. Without timestamps the GPU rate stays unknown and so does the split.
+    HybridSplit& last = m_hybridSplits[frameInFlight];
+    double gpuMs = 0.0;
+    if (last.gpuRows > 0 && m_profiler.GetFrameSample(frameInFlight, "Mandlebrot", gpuMs) && gpuMs > 0.0)
+        m_gpuRowsPerMs = Blend(m_gpuRowsPerMs, last.gpuRows / gpuMs);
+    if (last.cpuRows > 0 && last.cpuMs > 0.0)
+        m_cpuRowsPerMs = Blend(m_cpuRowsPerMs, last.cpuRows / last.cpuMs);
+
+    // Both finish together when each gets rows in proportion to its throughput. Half and half until both are measured.
+    double gpuShare = 0.5;
+    if (m_gpuRowsPerMs > 0.0 && m_cpuRowsPerMs > 0.0)
+        gpuShare = m_gpuRowsPerMs / (m_gpuRowsPerMs + m_cpuRowsPerMs);
+
+    // Whole workgroup rows, so the dispatch never reaches into the CPU's rows
+    const uint32_t band = m_settings.workgroupSizeY;
+    uint32_t gpuRows = (uint32_t)std::lround(gpuShare * m_imageHeight / band) * band;
+    gpuRows = std::min(gpuRows, m_imageHeight);
+
+    // At least one band each, a side that got nothing would never be measured again and the split couldn't recover
+    if (m_imageHeight >= 2 * band)
+        gpuRows = std::clamp(gpuRows, band, (m_imageHeight - band) / band * band);
+
+    last.gpuRows = gpuRows;
+    last.cpuRows = m_imageHeight - gpuRows;
+    last.cpuMs = 0.0;
+    m_lastGpuRows = gpuRows;
+    return gpuRows;
+}
+
+void ComputeTask::RenderCpuRows(const uint32_t& frameInFlight, const MandlebrotView& view, uint32_t gpuRows)
+{
+    const uint32_t cpuRows = m_imageHeight - gpuRows;
+    const VkDeviceSize offset = (VkDeviceSize)gpuRows * m_imageWidth * sizeof(uint32_t);
+
+    // The host already waited for this frame in flight's previous copy, the staging buffer is free
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t* pixels = (uint32_t*)((uint8_t*)m_stagingBufferMemory[frameInFlight].mappedData + offset);
+    m_cpuRenderer->Render(CpuMandlebrotParams::FromView(view, m_imageWidth, m_imageHeight, m_settings), gpuRows, cpuRows, pixels);
+    m_hybridSplits[frameInFlight].cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    FRAME_STATS_SCOPE(RECORD);
+    const VkCommandBuffer& commandBuffer = m_uploadCommandBuffers[frameInFlight];
+    ErrorCheck(vkResetCommandBuffer(commandBuffer, 0));
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    ErrorCheck(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = offset;
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageOffset = { 0, (int32_t)gpuRows, 0 };
+    region.imageExtent = { m_imageWidth, cpuRows, 1 };
+    vkCmdCopyBufferToImage(commandBuffer, m_stagingBuffers[frameInFlight], m_storageImages[frameInFlight],
+        VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+    // Covers the dispatch's writes as well, it was submitted earlier to the same queue
+    RecordStorageImageEpilogue(commandBuffer, frameInFlight,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+    ErrorCheck(vkEndCommandBuffer(commandBuffer));
+}
+
+void ComputeTask::UpdateSwapchainTarget(const uint32_t& frameInFlight,
+    const VkImage& image, const VkImageView& imageView, const VkExtent2D& extent, const VkSemaphore& imageAcquiredSemaphore,
+    const VkSemaphore& timelineSem, uint64_t signalValue, const MandlebrotView& view)
+{
+    assert(m_presentShaderModule != VK_NULL_HANDLE);
+
+    PushConstants pushConstants{};
+    MandlebrotPrecision precision = PreparePushConstants(view, frameInFlight, extent.width, extent.height, pushConstants);
+    {
+        FRAME_STATS_SCOPE(RECORD);
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageInfo.imageView = imageView;
+
+        VkWriteDescriptorSet write{};
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        write.dstBinding = 0;
+        write.dstSet = m_presentDescriptorSets[frameInFlight];
+        write.pImageInfo = &imageInfo;
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+
+        vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+        BuildCommandBuffers(frameInFlight, { m_presentPipelines[(uint32_t)precision], m_presentDescriptorSets[frameInFlight], image }, pushConstants,
+            extent.height);
+    }
+
+    VkSemaphoreSubmitInfo waitInfo
+    { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, imageAcquiredSemaphore, 0, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, 0 };
+
+    // ALL_COMMANDS so the transition to PRESENT_SRC is included
+    VkSemaphoreSubmitInfo signalInfo
+    { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, timelineSem, signalValue, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 0 };
+
+    Submit(m_commandBuffers[frameInFlight], &waitInfo, &signalInfo);
+}
+
+double ComputeTask::GetPixelStep(const MandlebrotView& view, uint32_t width, uint32_t height)
+{
+    return (2.0 + 1.7 * 0.2) * view.zoom / (double)std::min(width, height);
+}
+
+MandlebrotPrecision ComputeTask::SelectPrecision(const MandlebrotView& view, uint32_t width, uint32_t height)
+{
+    // Float ulps grow with the coordinates, below 1.0 the iterated z values (up to the escape radius) dominate
+    double magnitude = std::max({ std::abs(view.centerX), std::abs(view.centerY), 1.0 });
+    double step = GetPixelStep(view, width, height);
+    if (step >= magnitude * FLOAT_MIN_RELATIVE_STEP)
+        return MandlebrotPrecision::FLOAT;
+    return step >= magnitude * DF64_MIN_RELATIVE_STEP ? MandlebrotPrecision::DF64 : MandlebrotPrecision::PERTURBATION;
+}
+
+void ComputeTask::PrepareReferenceOrbit(const MandlebrotView& view, uint32_t frameInFlight, double step, PushConstants& pushConstants)
+{
+    assert(m_referenceOrbits);
+
+    const uint32_t limbCount = ReferenceOrbitBuilder::GetLimbCount(step);
+
+    BigFixed centerX = BigFixed::FromDouble(view.centerX, limbCount);
+    BigFixed centerY = BigFixed::FromDouble(view.centerY, limbCount);
+    if (!view.preciseCenterX.empty() && !BigFixed::Parse(view.preciseCenterX, limbCount, centerX))
+        centerX = BigFixed::FromDouble(view.centerX, limbCount);
+    if (!view.preciseCenterY.empty() && !BigFixed::Parse(view.preciseCenterY, limbCount, centerY))
+        centerY = BigFixed::FromDouble(view.centerY, limbCount);
+
+    m_referenceOrbits->Request(centerX, centerY, m_settings.maxIterations);
+
+    // View center relative to the reference, in pixels it has to stay small for the float deltas
+    auto OffsetTo = [&](const ReferenceOrbit& orbit, double& offsetX, double& offsetY)
+    {
+        offsetX = (centerX - orbit.centerX.WithLimbCount(limbCount)).ToDouble();
+        offsetY = (centerY - orbit.centerY.WithLimbCount(limbCount)).ToDouble();
+        return std::max(std::abs(offsetX), std::abs(offsetY)) / step <= MAX_REFERENCE_DISTANCE_PIXELS;
+    };
+
+    // Nothing to fall back on for the first deep frame or after a jump, wait for the orbit in that case
+    double offsetX = 0.0, offsetY = 0.0;
+    std::shared_ptr<const ReferenceOrbit> orbit = m_referenceOrbits->GetLatest();
+    if (!orbit || !OffsetTo(*orbit, offsetX, offsetY))
+    {
+        orbit = m_referenceOrbits->WaitForLatest();
+        OffsetTo(*orbit, offsetX, offsetY);
+    }
+
+    // The host already waited for this frame in flight's previous dispatch, its buffer is free to rewrite
+    if (m_orbitBufferVersions[frameInFlight] != orbit->version)
+    {
+        CopyDataIntoHostCoherentMemory(orbit->points.size() * sizeof(float), orbit->points.data(), m_orbitBufferMemory[frameInFlight]);
+        m_orbitBufferVersions[frameInFlight] = orbit->version;
+    }
+
+    // Deltas in units of 2^exponent, the step comes out in [1, 2)
+    const int exponent = std::ilogb(step);
+    pushConstants.centerX[0] = (float)std::ldexp(offsetX, -exponent);
+    pushConstants.centerX[1] = 0.0f;
+    pushConstants.centerY[0] = (float)std::ldexp(offsetY, -exponent);
+    pushConstants.centerY[1] = 0.0f;
+    pushConstants.step[0] = (float)std::ldexp(step, -exponent);
+    pushConstants.step[1] = 0.0f;
+    pushConstants.deltaExponent = exponent;
+    pushConstants.orbitLength = orbit->GetLength();
+}
+
+MandlebrotPrecision ComputeTask::PreparePushConstants(const MandlebrotView& view, uint32_t frameInFlight, uint32_t width, uint32_t height,
+    PushConstants& pushConstants)
+{
+    MandlebrotPrecision precision = m_settings.precision;
+    if (precision == MandlebrotPrecision::AUTO)
+        precision = SelectPrecision(view, width, height);
+
+    const double step = GetPixelStep(view, width, height);
+    pushConstants.width = width;
+    pushConstants.height = height;
+    pushConstants.maxIterations = m_settings.maxIterations;
+    if (precision == MandlebrotPrecision::PERTURBATION)
+    {
+        PrepareReferenceOrbit(view, frameInFlight, step, pushConstants);
+    }
+    else
+    {
+        SplitDouble(view.centerX, pushConstants.centerX);
+        SplitDouble(view.centerY, pushConstants.centerY);
+        SplitDouble(step, pushConstants.step);
+    }
+
+    m_lastPrecision = precision;
+    return precision;
+}
+
+void ComputeTask::SetReadbackRing(ReadbackRing* readbackRing)
+{
+    m_readbackRing = readbackRing;
+}
+
+double ComputeTask::GetGpuRowShare() const
+{
+    if (!m_cpuRenderer)
+        return 1.0;
+    return (double)m_lastGpuRows / m_imageHeight;
+}
+
+double ComputeTask::GetIteratedPixelFraction(uint32_t frameInFlight) const
+{
+    if (m_settings.kernel != MandlebrotKernel::MARIANI_SILVER || m_tilePixelCounts[frameInFlight] == 0)
+        return 1.0;
+
+    uint32_t iteratedPixels = 0;
+    CopyDataFromHostCoherentMemory(sizeof(uint32_t), &iteratedPixels, m_tileStatsMemory[frameInFlight]);
+    return (double)iteratedPixels / m_tilePixelCounts[frameInFlight];
+}
+
+MandlebrotPrecision ComputeTask::GetLastPrecision() const
+{
+    return m_lastPrecision;
+}
+
+const char* ComputeTask::GetPrecisionName(MandlebrotPrecision precision)
+{
+    switch (precision)
+    {
+    case MandlebrotPrecision::FLOAT: return "float";
+    case MandlebrotPrecision::DF64: return "df64";
+    case MandlebrotPrecision::PERTURBATION: return "perturbation";
+    case MandlebrotPrecision::AUTO: return "auto";
+    }
+    return "unknown";
+}
+
+const char* ComputeTask::GetKernelName(MandlebrotKernel kernel)
+{
+    switch (kernel)
+    {
+    case MandlebrotKernel::GRID: return "grid";
+    case MandlebrotKernel::PERSISTENT: return "persistent";
+    case MandlebrotKernel::MARIANI_SILVER: return "mariani-silver";
+    }
+    return "unknown";
+}
+
+bool ComputeTask::ParseKernel(const std::string& name, MandlebrotKernel& kernel)
+{
+    if (name == "grid")
+        kernel = MandlebrotKernel::GRID;
+    else if (name == "persistent")
+        kernel = MandlebrotKernel::PERSISTENT;
+    else if (name == "mariani-silver")
+        kernel = MandlebrotKernel::MARIANI_SILVER;
+    else
+        return false;
+    return true;
+}
+
+void ComputeTask::SetReleaseQueueFamily(uint32_t queueFamilyIndex)
+{
+    m_releaseQueueFamily = queueFamilyIndex;
+}
+
+bool ComputeTask::IsReleasingStorageImages() const
+{
+    return m_releaseQueueFamily != VK_QUEUE_FAMILY_IGNORED && m_releaseQueueFamily != m_queueFamilyIndex;
+}
+
+uint32_t ComputeTask::GetQueueFamilyIndex() const
+{
+    return m_queueFamilyIndex;
+}
+
+const std::vector<VkImage>& ComputeTask::GetStorageImages()
+{
+    return m_storageImages;
+}
+
+const std::vector<VkImageView>& ComputeTask::GetStorageImageViews()
+{
+    return m_storageImageViews;
+}
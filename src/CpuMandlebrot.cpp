@@ -0,0 +1,312 @@
+#include "CpuMandlebrot.h"
+#include "CpuMandlebrotKernel.h"
+#include "ComputeTask.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef CPU_SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+    // A tile is a few rows of 64 pixels, small enough for stealing to even out the cores, big enough that taking
+    // one costs nothing next to iterating it
+    constexpr uint32_t TILE_WIDTH = 64;
+    constexpr uint32_t TILE_HEIGHT = 8;
+
+    // RenderPrecise wants a pixel to span this many ulps of the coordinates at least
+    constexpr int PRECISE_GUARD_BITS = 6;
+
+    // IterateFloat of MandlebrotCore.glsl in long double, minus the cycle detection which never changes a count
+    uint32_t IteratePrecise(long double cx, long double cy, uint32_t maxIterations, bool interiorCulling)
+    {
+        if (interiorCulling)
+        {
+            long double xq = cx - 0.25L;
+            long double y2 = cy * cy;
+            long double q = xq * xq + y2;
+            if (q * (q + xq) <= 0.25L * y2 || (cx + 1.0L) * (cx + 1.0L) + y2 <= 0.0625L)
+                return maxIterations;
+        }
+
+        const long double escapeRadiusSquared = interiorCulling ? 4.0L : 2.0L;
+        long double zx = 0.0L, zy = 0.0L;
+        uint32_t n = 0;
+        for (; n < maxIterations; n++)
+        {
+            long double zx2 = zx * zx;
+            long double zy2 = zy * zy;
+            zy = 2.0L * zx * zy + cy;
+            zx = zx2 - zy2 + cx;
+            if (zx * zx + zy * zy > escapeRadiusSquared)
+                break;
+        }
+        return n;
+    }
+
+    struct ScalarOps
+    {
+        using Vec = float;
+        using Mask = bool;
+        static constexpr uint32_t LANES = 1;
+
+        static Vec Set(float value) { return value; }
+        static Vec LaneIndices() { return 0.0f; }
+        static Vec Add(Vec a, Vec b) { return a + b; }
+        static Vec Sub(Vec a, Vec b) { return a - b; }
+        static Vec Mul(Vec a, Vec b) { return a * b; }
+        static Mask Greater(Vec a, Vec b) { return a > b; }
+        static Mask LessEqual(Vec a, Vec b) { return a <= b; }
+        static Mask Or(Mask a, Mask b) { return a || b; }
+        static Mask AndNot(Mask a, Mask b) { return !a && b; }
+        static Mask All() { return true; }
+        static bool Any(Mask mask) { return mask; }
+        static Vec Select(Mask mask, Vec a, Vec b) { return mask ? a : b; }
+        static void Store(float* destination, Vec value) { *destination = value; }
+    };
+
+#ifdef CPU_SIMD_X86
+    void Cpuid(uint32_t leaf, uint32_t subleaf, uint32_t (&registers)[4])
+    {
+#ifdef _MSC_VER
+        int values[4];
+        __cpuidex(values, (int)leaf, (int)subleaf);
+        for (uint32_t i = 0; i < 4; i++)
+            registers[i] = (uint32_t)values[i];
+#else
+        __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+    }
+
+    // Register state the OS saves on a context switch (XCR0)
+    uint64_t GetEnabledXsaveFeatures()
+    {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        uint32_t low = 0, high = 0;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return ((uint64_t)high << 32) | low;
+#endif
+    }
+#endif
+}
+
+void IterateRowScalar(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations)
+{
+    IterateRow<ScalarOps>(params, x, y, count, iterations);
+}
+
+CpuMandlebrotParams CpuMandlebrotParams::FromView(const MandlebrotView& view, uint32_t width, uint32_t height, const MandlebrotSettings& settings)
+{
+    CpuMandlebrotParams params{};
+    params.centerX = (float)view.centerX;
+    params.centerY = (float)view.centerY;
+    params.step = (float)ComputeTask::GetPixelStep(view, width, height);
+    params.width = width;
+    params.height = height;
+    params.maxIterations = settings.maxIterations;
+    params.interiorCulling = settings.interiorCulling;
+    return params;
+}
+
+CpuMandlebrot::CpuMandlebrot(uint32_t threadCount, CpuSimdLevel maxSimdLevel) :
+    m_pool(threadCount), m_simdLevel(std::min(DetectSimdLevel(), maxSimdLevel))
+{
+    switch (m_simdLevel)
+    {
+#ifdef CPU_SIMD_X86
+    case CpuSimdLevel::AVX512: m_iterateRow = IterateRowAvx512; break;
+    case CpuSimdLevel::AVX2: m_iterateRow = IterateRowAvx2; break;
+    case CpuSimdLevel::SSE2: m_iterateRow = IterateRowSse2; break;
+#endif
+    default:
+        m_simdLevel = CpuSimdLevel::SCALAR;
+        m_iterateRow = IterateRowScalar;
+        break;
+    }
+}
+
+void CpuMandlebrot::BuildPalette(uint32_t maxIterations)
+{
+    if (m_paletteMaxIterations == maxIterations && !m_palette.empty())
+        return;
+
+    // Palette() of MandlebrotCore.glsl, stored the way an rgba8 storage image rounds it
+    auto ToUnorm8 = [](float value)
+    {
+        return (uint32_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+    };
+
+    const float d[3] = { 0.3f, 0.3f, 0.5f };
+    const float e[3] = { -0.2f, -0.3f, -0.5f };
+    const float f[3] = { 2.1f, 2.0f, 3.0f };
+    const float g[3] = { 0.0f, 0.1f, 0.0f };
+
+    m_palette.resize((size_t)maxIterations + 1);
+    for (uint32_t n = 0; n <= maxIterations; n++)
+    {
+        float t = float(n) / float(maxIterations);
+        uint32_t color = 255u << 24;
+        for (uint32_t channel = 0; channel < 3; channel++)
+        {
+            float value = d[channel] + e[channel] * std::cos(6.28318f * (f[channel] * t + g[channel]));
+            color |= ToUnorm8(value) << (8 * channel);
+        }
+        m_palette[n] = color;
+    }
+    m_paletteMaxIterations = maxIterations;
+}
+
+void CpuMandlebrot::Render(const CpuMandlebrotParams& params, uint32_t* pixels)
+{
+    Render(params, 0, params.height, pixels);
+}
+
+void CpuMandlebrot::Render(const CpuMandlebrotParams& params, uint32_t firstRow, uint32_t rowCount, uint32_t* pixels)
+{
+    BuildPalette(params.maxIterations);
+
+    const uint32_t tilesX = (params.width + TILE_WIDTH - 1) / TILE_WIDTH;
+    const uint32_t tilesY = (rowCount + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    m_pool.Run(tilesX * tilesY, [&](uint32_t tile, uint32_t)
+    {
+        const uint32_t x = (tile % tilesX) * TILE_WIDTH;
+        const uint32_t width = std::min(TILE_WIDTH, params.width - x);
+        const uint32_t tileFirstRow = firstRow + (tile / tilesX) * TILE_HEIGHT;
+        const uint32_t tileLastRow = std::min(tileFirstRow + TILE_HEIGHT, firstRow + rowCount);
+
+        float iterations[TILE_WIDTH];
+        for (uint32_t y = tileFirstRow; y < tileLastRow; y++)
+        {
+            m_iterateRow(params, x, y, width, iterations);
+            uint32_t* row = pixels + (size_t)(y - firstRow) * params.width + x;
+            for (uint32_t i = 0; i < width; i++)
+                row[i] = m_palette[(uint32_t)iterations[i]];
+        }
+    });
+}
+
+void CpuMandlebrot::RenderIterations(const CpuMandlebrotParams& params, float* iterations)
+{
+    const uint32_t tilesX = (params.width + TILE_WIDTH - 1) / TILE_WIDTH;
+    const uint32_t tilesY = (params.height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    m_pool.Run(tilesX * tilesY, [&](uint32_t tile, uint32_t)
+    {
+        const uint32_t x = (tile % tilesX) * TILE_WIDTH;
+        const uint32_t width = std::min(TILE_WIDTH, params.width - x);
+        const uint32_t firstRow = (tile / tilesX) * TILE_HEIGHT;
+        const uint32_t lastRow = std::min(firstRow + TILE_HEIGHT, params.height);
+
+        for (uint32_t y = firstRow; y < lastRow; y++)
+            m_iterateRow(params, x, y, width, iterations + (size_t)y * params.width + x);
+    });
+}
+
+bool CpuMandlebrot::RenderPrecise(const MandlebrotView& view, uint32_t width, uint32_t height, const MandlebrotSettings& settings,
+    uint32_t* pixels)
+{
+    const long double centerX = view.preciseCenterX.empty() ? view.centerX : std::stold(view.preciseCenterX);
+    const long double centerY = view.preciseCenterY.empty() ? view.centerY : std::stold(view.preciseCenterY);
+    const long double step = ComputeTask::GetPixelStep(view, width, height);
+
+    const long double magnitude = std::max({ std::abs(centerX), std::abs(centerY), 1.0L });
+    if (step < magnitude * std::ldexp(1.0L, PRECISE_GUARD_BITS - std::numeric_limits<long double>::digits))
+        return false;
+
+    BuildPalette(settings.maxIterations);
+
+    const uint32_t tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    const uint32_t tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    m_pool.Run(tilesX * tilesY, [&](uint32_t tile, uint32_t)
+    {
+        const uint32_t x = (tile % tilesX) * TILE_WIDTH;
+        const uint32_t lastColumn = std::min(x + TILE_WIDTH, width);
+        const uint32_t firstRow = (tile / tilesX) * TILE_HEIGHT;
+        const uint32_t lastRow = std::min(firstRow + TILE_HEIGHT, height);
+
+        for (uint32_t y = firstRow; y < lastRow; y++)
+        {
+            const long double cy = centerY + ((long double)y - 0.5L * height) * step;
+            for (uint32_t column = x; column < lastColumn; column++)
+            {
+                const long double cx = centerX + ((long double)column - 0.5L * width) * step;
+                pixels[(size_t)y * width + column] = m_palette[IteratePrecise(cx, cy, settings.maxIterations, settings.interiorCulling)];
+            }
+        }
+    });
+    return true;
+}
+
+CpuSimdLevel CpuMandlebrot::GetSimdLevel() const
+{
+    return m_simdLevel;
+}
+
+uint32_t CpuMandlebrot::GetThreadCount() const
+{
+    return m_pool.GetThreadCount();
+}
+
+CpuSimdLevel CpuMandlebrot::DetectSimdLevel()
+{
+#ifdef CPU_SIMD_X86
+    // SSE2 is part of x86-64, the wider sets need the CPU to have them and the OS to save their registers
+    uint32_t registers[4];
+    Cpuid(0, 0, registers);
+    const uint32_t maxLeaf = registers[0];
+
+    Cpuid(1, 0, registers);
+    const bool osxsave = (registers[2] & (1u << 27)) != 0;
+    const bool avx = (registers[2] & (1u << 28)) != 0;
+    if (!osxsave || !avx || maxLeaf < 7)
+        return CpuSimdLevel::SSE2;
+
+    const uint64_t xcr0 = GetEnabledXsaveFeatures();
+    Cpuid(7, 0, registers);
+    const bool avx2 = (registers[1] & (1u << 5)) != 0;
+    const bool avx512f = (registers[1] & (1u << 16)) != 0;
+
+    // XMM | YMM, plus opmask and both halves of ZMM for AVX-512
+    if (avx512f && (xcr0 & 0xE6) == 0xE6)
+        return CpuSimdLevel::AVX512;
+    if (avx2 && (xcr0 & 0x6) == 0x6)
+        return CpuSimdLevel::AVX2;
+    return CpuSimdLevel::SSE2;
+#else
+    return CpuSimdLevel::SCALAR;
+#endif
+}
+
+const char* CpuMandlebrot::GetSimdLevelName(CpuSimdLevel level)
+{
+    switch (level)
+    {
+    case CpuSimdLevel::SCALAR: return "scalar";
+    case CpuSimdLevel::SSE2: return "sse2";
+    case CpuSimdLevel::AVX2: return "avx2";
+    case CpuSimdLevel::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+bool CpuMandlebrot::ParseSimdLevel(const std::string& name, CpuSimdLevel& level)
+{
+    if (name == "scalar")
+        level = CpuSimdLevel::SCALAR;
+    else if (name == "sse2")
+        level = CpuSimdLevel::SSE2;
+    else if (name == "avx2")
+        level = CpuSimdLevel::AVX2;
+    else if (name == "avx512")
+        level = CpuSimdLevel::AVX512;
+    else
+        return false;
+    return true;
+}
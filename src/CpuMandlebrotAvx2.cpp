@@ -0,0 +1,37 @@
+#include "CpuMandlebrotKernel.h"
+
+// Built with AVX2 code generation (CMakeLists.txt), only called once CPUID reported AVX2
+#ifdef CPU_SIMD_X86
+#include <immintrin.h>
+
+namespace
+{
+    struct Avx2Ops
+    {
+        using Vec = __m256;
+        using Mask = __m256;
+        static constexpr uint32_t LANES = 8;
+
+        static Vec Set(float value) { return _mm256_set1_ps(value); }
+        static Vec LaneIndices() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+        static Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+        static Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+        static Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+        static Mask Greater(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static Mask LessEqual(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static Mask Or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+        // b and not a
+        static Mask AndNot(Mask a, Mask b) { return _mm256_andnot_ps(a, b); }
+        static Mask All() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+        static bool Any(Mask mask) { return _mm256_movemask_ps(mask) != 0; }
+        static Vec Select(Mask mask, Vec a, Vec b) { return _mm256_blendv_ps(b, a, mask); }
+        static void Store(float* destination, Vec value) { _mm256_storeu_ps(destination, value); }
+    };
+}
+
+void IterateRowAvx2(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations)
+{
+    IterateRow<Avx2Ops>(params, x, y, count, iterations);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include "CpuMandlebrotKernel.h"
+
+// Built with AVX-512F code generation (CMakeLists.txt), only called once CPUID reported AVX-512F
+#ifdef CPU_SIMD_X86
+#include <immintrin.h>
+
+namespace
+{
+    // Comparisons produce mask registers instead of vectors
+    struct Avx512Ops
+    {
+        using Vec = __m512;
+        using Mask = __mmask16;
+        static constexpr uint32_t LANES = 16;
+
+        static Vec Set(float value) { return _mm512_set1_ps(value); }
+        static Vec LaneIndices()
+        {
+            return _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+        }
+        static Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+        static Vec Sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+        static Vec Mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+        static Mask Greater(Vec a, Vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+        static Mask LessEqual(Vec a, Vec b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+        static Mask Or(Mask a, Mask b) { return (Mask)(a | b); }
+        // b and not a
+        static Mask AndNot(Mask a, Mask b) { return (Mask)(~a & b); }
+        static Mask All() { return (Mask)0xFFFF; }
+        static bool Any(Mask mask) { return mask != 0; }
+        static Vec Select(Mask mask, Vec a, Vec b) { return _mm512_mask_blend_ps(mask, b, a); }
+        static void Store(float* destination, Vec value) { _mm512_storeu_ps(destination, value); }
+    };
+}
+
+void IterateRowAvx512(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations)
+{
+    IterateRow<Avx512Ops>(params, x, y, count, iterations);
+}
+
+#endif
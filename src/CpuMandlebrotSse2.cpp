@@ -0,0 +1,36 @@
+#include "CpuMandlebrotKernel.h"
+
+#ifdef CPU_SIMD_X86
+#include <emmintrin.h>
+
+namespace
+{
+    struct Sse2Ops
+    {
+        using Vec = __m128;
+        using Mask = __m128;
+        static constexpr uint32_t LANES = 4;
+
+        static Vec Set(float value) { return _mm_set1_ps(value); }
+        static Vec LaneIndices() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+        static Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+        static Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+        static Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+        static Mask Greater(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+        static Mask LessEqual(Vec a, Vec b) { return _mm_cmple_ps(a, b); }
+        static Mask Or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+        // b and not a
+        static Mask AndNot(Mask a, Mask b) { return _mm_andnot_ps(a, b); }
+        static Mask All() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+        static bool Any(Mask mask) { return _mm_movemask_ps(mask) != 0; }
+        static Vec Select(Mask mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        static void Store(float* destination, Vec value) { _mm_storeu_ps(destination, value); }
+    };
+}
+
+void IterateRowSse2(const CpuMandlebrotParams& params, uint32_t x, uint32_t y, uint32_t count, float* iterations)
+{
+    IterateRow<Sse2Ops>(params, x, y, count, iterations);
+}
+
+#endif
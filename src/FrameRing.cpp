@@ -0,0 +1,95 @@
+#include "FrameRing.h"
+#include "FrameStats.h"
+#include <assert.h>
+
+FrameRing::FrameRing(const VkDevice& device, uint32_t framesInFlight, TimelineStages retireStage) :
+    m_device(device), m_retireStage(retireStage)
+{
+    assert(framesInFlight > 0);
+
+    m_slots.resize(framesInFlight);
+    for (auto& slot : m_slots)
+    {
+        slot.timeline = std::make_unique<TimelineSemaphore>(m_device);
+
+        VkSemaphoreCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        ErrorCheck(vkCreateSemaphore(m_device, &info, nullptr, &slot.imageAcquiredSemaphore));
+    }
+}
+
+FrameRing::~FrameRing()
+{
+    WaitIdle();
+
+    for (auto& slot : m_slots)
+    {
+        vkDestroySemaphore(m_device, slot.imageAcquiredSemaphore, nullptr);
+        slot.timeline.reset();
+    }
+}
+
+bool FrameRing::WaitForSlot(uint32_t slot)
+{
+    TimelineSemaphore& timeline = *m_slots[slot].timeline;
+    if (timeline.GetFrameIndex() == 0)
+        return false;
+
+    // The frame index was already incremented by EndFrame(), the previous frame is one behind
+    uint64_t value = (timeline.GetFrameIndex() - 1) * (TimelineStages::NUM_STAGES - 1) + m_retireStage;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.pSemaphores = &timeline.GetSemaphore();
+    waitInfo.pValues = &value;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+
+    ErrorCheck(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+    return true;
+}
+
+FrameRing::Frame FrameRing::BeginFrame()
+{
+    assert(!m_frameBegun);
+    m_frameBegun = true;
+
+    bool slotRetired = false;
+    {
+        FRAME_STATS_SCOPE(FENCE_WAIT);
+        slotRetired = WaitForSlot(m_currentSlot);
+    }
+
+    Slot& slot = m_slots[m_currentSlot];
+    return Frame{ m_currentSlot, m_frameIndex, *slot.timeline, slot.imageAcquiredSemaphore, slotRetired };
+}
+
+void FrameRing::EndFrame()
+{
+    assert(m_frameBegun);
+    m_frameBegun = false;
+
+    m_slots[m_currentSlot].timeline->IncrementFrameIndex();
+    m_frameIndex++;
+    m_currentSlot = (m_currentSlot + 1) % (uint32_t)m_slots.size();
+}
+
+void FrameRing::WaitIdle()
+{
+    for (uint32_t i = 0; i < (uint32_t)m_slots.size(); i++)
+        WaitForSlot(i);
+}
+
+uint32_t FrameRing::GetFramesInFlight() const
+{
+    return (uint32_t)m_slots.size();
+}
+
+uint32_t FrameRing::GetCurrentSlot() const
+{
+    return m_currentSlot;
+}
+
+uint64_t FrameRing::GetFrameIndex() const
+{
+    return m_frameIndex;
+}
@@ -0,0 +1,199 @@
+#include "FrameStats.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+namespace
+{
+    const char* GetPhaseName(size_t phase)
+    {
+        switch ((FramePhase)phase)
+        {
+        case FramePhase::FENCE_WAIT: return "fence_wait";
+        case FramePhase::RECORD: return "record";
+        case FramePhase::SUBMIT: return "submit";
+        case FramePhase::ACQUIRE: return "acquire";
+        case FramePhase::PRESENT: return "present";
+        case FramePhase::FRAME: return "frame";
+        default: return "unknown";
+        }
+    }
+
+    bool EndsWith(const std::string& str, const std::string& suffix)
+    {
+        return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}
+
+uint32_t LatencyHistogram::GetBucketIndex(uint64_t us)
+{
+    if (us < SUB_BUCKETS)
+        return (uint32_t)us;
+
+    // Position of the highest set bit picks the power, the next SUB_BUCKET_BITS bits pick the sub-bucket
+    uint32_t power = 0;
+    while ((us >> (power + 1)) != 0)
+        power++;
+    if (power > MAX_POWER)
+        return OVERFLOW_BUCKET;
+
+    uint32_t subBucket = (uint32_t)(us >> (power - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (power - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+}
+
+double LatencyHistogram::GetBucketUpperBound(uint32_t index)
+{
+    // The first buckets hold exactly one value each
+    if (index < SUB_BUCKETS)
+        return index;
+    // Nothing is known above the covered range, its lower edge is the best bound there is
+    if (index == OVERFLOW_BUCKET)
+        return std::ldexp(1.0, (int)MAX_POWER + 1);
+
+    uint32_t power = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint32_t subBucket = index % SUB_BUCKETS;
+    return std::ldexp(1.0 + (subBucket + 1.0) / SUB_BUCKETS, (int)power);
+}
+
+void LatencyHistogram::Record(uint64_t us)
+{
+    m_buckets[GetBucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sumUs.fetch_add(us, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset()
+{
+    for (auto& bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sumUs.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetAverage() const
+{
+    uint64_t count = GetCount();
+    return count == 0 ? 0.0 : (double)m_sumUs.load(std::memory_order_relaxed) / count;
+}
+
+double LatencyHistogram::GetPercentile(double percentile) const
+{
+    uint64_t count = GetCount();
+    if (count == 0)
+        return 0.0;
+
+    uint64_t target = (uint64_t)std::ceil(count * percentile / 100.0);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target)
+            return GetBucketUpperBound(i);
+    }
+    return GetBucketUpperBound(NUM_BUCKETS - 1);
+}
+
+FrameStats& FrameStats::Get()
+{
+    static FrameStats instance;
+    return instance;
+}
+
+void FrameStats::Configure(uint64_t dumpInterval, const std::string& outputPath)
+{
+    m_dumpInterval = dumpInterval;
+    m_outputPath = outputPath;
+}
+
+void FrameStats::AddPhaseTime(FramePhase phase, uint64_t us)
+{
+    m_currentFrameUs[(size_t)phase] += us;
+}
+
+void FrameStats::EndFrame()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (m_frameCount > 0)
+    {
+        m_currentFrameUs[(size_t)FramePhase::FRAME] = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - m_frameBegin).count();
+    }
+    m_frameBegin = now;
+
+    // The first frame has no begin to measure from, only its phases are recorded
+    for (size_t i = 0; i < m_histograms.size(); i++)
+    {
+        if (i != (size_t)FramePhase::FRAME || m_frameCount > 0)
+            m_histograms[i].Record(m_currentFrameUs[i]);
+        m_currentFrameUs[i] = 0;
+    }
+
+    m_frameCount++;
+    if (m_dumpInterval > 0 && m_frameCount % m_dumpInterval == 0)
+    {
+        Dump();
+        for (auto& histogram : m_histograms)
+            histogram.Reset();
+    }
+}
+
+void FrameStats::Dump()
+{
+    if (m_outputPath.empty())
+    {
+        std::cout << "Frame stats @" << m_frameCount << " (us)    p50       p95       p99       avg" << std::endl;
+        for (size_t i = 0; i < m_histograms.size(); i++)
+        {
+            std::cout << "  " << std::left << std::setw(20) << GetPhaseName(i) << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << m_histograms[i].GetPercentile(50.0)
+                << std::setw(10) << m_histograms[i].GetPercentile(95.0)
+                << std::setw(10) << m_histograms[i].GetPercentile(99.0)
+                << std::setw(10) << m_histograms[i].GetAverage() << std::endl;
+        }
+        std::cout.unsetf(std::ios::floatfield);
+        return;
+    }
+
+    const bool json = EndsWith(m_outputPath, ".json");
+    const bool writeHeader = !json && !std::ifstream(m_outputPath).good();
+
+    std::ofstream file(m_outputPath, std::ios::app);
+    if (!file.is_open())
+    {
+        std::cout << "FrameStats : couldn't open " << m_outputPath << std::endl;
+        return;
+    }
+
+    // CSV gets one row per phase, JSON one object per line (JSON Lines) so appending keeps the file valid
+    if (json)
+    {
+        file << "{\"frame\":" << m_frameCount << ",\"phases\":{";
+        for (size_t i = 0; i < m_histograms.size(); i++)
+        {
+            file << (i == 0 ? "" : ",") << "\"" << GetPhaseName(i) << "\":{"
+                << "\"p50_us\":" << m_histograms[i].GetPercentile(50.0) << ","
+                << "\"p95_us\":" << m_histograms[i].GetPercentile(95.0) << ","
+                << "\"p99_us\":" << m_histograms[i].GetPercentile(99.0) << ","
+                << "\"avg_us\":" << m_histograms[i].GetAverage() << "}";
+        }
+        file << "}}\n";
+    }
+    else
+    {
+        if (writeHeader)
+            file << "frame,phase,p50_us,p95_us,p99_us,avg_us\n";
+        for (size_t i = 0; i < m_histograms.size(); i++)
+        {
+            file << m_frameCount << "," << GetPhaseName(i) << ","
+                << m_histograms[i].GetPercentile(50.0) << ","
+                << m_histograms[i].GetPercentile(95.0) << ","
+                << m_histograms[i].GetPercentile(99.0) << ","
+                << m_histograms[i].GetAverage() << "\n";
+        }
+    }
+}
@@ -0,0 +1,210 @@
+#include "GpuProfiler.h"
+#include "Utils.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+namespace
+{
+    constexpr size_t MAX_SAMPLES_PER_SCOPE = 4096;
+    constexpr uint32_t INVALID_SCOPE = ~0u;
+}
+
+GpuProfiler::GpuProfiler(const VkDevice& device, const VkPhysicalDevice& physicalDevice, const std::vector<uint32_t>& queueFamilyIndices,
+    uint32_t maxFrameInFlight, uint32_t maxScopesPerFrame) :
+    m_device(device), m_maxScopesPerFrame(maxScopesPerFrame), m_maxFrameInFlights(maxFrameInFlight)
+{
+    VkPhysicalDeviceProperties deviceProp{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProp);
+    m_timestampPeriod = deviceProp.limits.timestampPeriod;
+
+    uint32_t qFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &qFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> propertyList(qFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &qFamilyCount, propertyList.data());
+
+    uint32_t validBits = 64;
+    for (uint32_t queueFamilyIndex : queueFamilyIndices)
+        validBits = std::min(validBits, propertyList[queueFamilyIndex].timestampValidBits);
+    m_enabled = validBits > 0;
+    m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    m_frames.resize(maxFrameInFlight);
+
+    if (!m_enabled)
+    {
+        std::cout << "GpuProfiler : timestamps not supported on every queue family in use, disabled" << std::endl;
+        return;
+    }
+
+    VkQueryPoolCreateInfo createInfo{};
+    createInfo.queryCount = maxFrameInFlight * maxScopesPerFrame * 2;
+    createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+
+    ErrorCheck(vkCreateQueryPool(m_device, &createInfo, nullptr, &m_queryPool));
+
+    // Queries have to be reset before their first use
+    vkResetQueryPool(m_device, m_queryPool, 0, createInfo.queryCount);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (m_queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+}
+
+uint32_t GpuProfiler::GetFirstQuery(uint32_t frameInFlight) const
+{
+    return frameInFlight * m_maxScopesPerFrame * 2;
+}
+
+uint32_t GpuProfiler::GetReservedSlotCount() const
+{
+    return (uint32_t)m_reservedScopeNames.size();
+}
+
+uint32_t GpuProfiler::BeginScope(const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, const char* name)
+{
+    auto& frame = m_frames[frameInFlight];
+    if (!m_enabled || frame.nextSlot == m_maxScopesPerFrame - GetReservedSlotCount())
+        return INVALID_SCOPE;
+
+    uint32_t scope = frame.nextSlot++;
+    frame.scopes.push_back({ scope, name });
+
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_queryPool, GetFirstQuery(frameInFlight) + scope * 2);
+    return scope;
+}
+
+void GpuProfiler::EndScope(const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, uint32_t scope)
+{
+    if (scope == INVALID_SCOPE)
+        return;
+
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, GetFirstQuery(frameInFlight) + scope * 2 + 1);
+}
+
+uint32_t GpuProfiler::ReserveScope(const char* name)
+{
+    assert(std::all_of(m_frames.begin(), m_frames.end(), [](const FrameQueries& frame) { return frame.nextSlot == 0; }));
+    if (!m_enabled || GetReservedSlotCount() == m_maxScopesPerFrame)
+        return INVALID_SCOPE;
+
+    m_reservedScopeNames.push_back(name);
+    return m_maxScopesPerFrame - GetReservedSlotCount();
+}
+
+uint32_t GpuProfiler::BeginReservedScope(const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, uint32_t reservedScope)
+{
+    if (reservedScope == INVALID_SCOPE)
+        return INVALID_SCOPE;
+
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_queryPool, GetFirstQuery(frameInFlight) + reservedScope * 2);
+    return reservedScope;
+}
+
+void GpuProfiler::SubmitReservedScope(uint32_t frameInFlight, uint32_t reservedScope)
+{
+    if (reservedScope == INVALID_SCOPE)
+        return;
+
+    m_frames[frameInFlight].scopes.push_back({ reservedScope, m_reservedScopeNames[m_maxScopesPerFrame - 1 - reservedScope] });
+}
+
+void GpuProfiler::Collect(uint32_t frameInFlight)
+{
+    auto& frame = m_frames[frameInFlight];
+    frame.collected.clear();
+    if (frame.scopes.empty())
+        return;
+
+    const uint32_t firstQuery = GetFirstQuery(frameInFlight);
+
+    for (auto& scope : frame.scopes)
+    {
+        // Availability is guaranteed by the caller, no WAIT bit so a misuse shows up as VK_NOT_READY instead of a stall
+        uint64_t timestamps[2]{};
+        VkResult result = vkGetQueryPoolResults(m_device, m_queryPool, firstQuery + scope.slot * 2, 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+        if (result == VK_SUCCESS)
+        {
+            uint64_t ticks = ((timestamps[1] & m_timestampMask) - (timestamps[0] & m_timestampMask)) & m_timestampMask;
+            double ms = ticks * m_timestampPeriod / 1000000.0;
+
+            auto& stats = m_statistics[scope.name];
+            if (stats.samples.size() < MAX_SAMPLES_PER_SCOPE)
+            {
+                stats.samples.push_back(ms);
+            }
+            else
+            {
+                stats.samples[stats.nextSample] = ms;
+                stats.nextSample = (stats.nextSample + 1) % MAX_SAMPLES_PER_SCOPE;
+            }
+            stats.min = stats.count == 0 ? ms : std::min(stats.min, ms);
+            stats.sum += ms;
+            stats.count++;
+            frame.collected[scope.name] = ms;
+        }
+    }
+
+    vkResetQueryPool(m_device, m_queryPool, firstQuery, m_maxScopesPerFrame * 2);
+    frame.scopes.clear();
+    frame.nextSlot = 0;
+}
+
+void GpuProfiler::ResetStatistics()
+{
+    m_statistics.clear();
+}
+
+GpuProfiler::ScopeSummary GpuProfiler::GetSummary(const std::string& name) const
+{
+    ScopeSummary summary{};
+    auto it = m_statistics.find(name);
+    if (it == m_statistics.end() || it->second.count == 0)
+        return summary;
+
+    const auto& stats = it->second;
+
+    std::vector<double> sorted = stats.samples;
+    size_t p99Index = std::min(sorted.size() - 1, (size_t)(sorted.size() * 0.99));
+    std::nth_element(sorted.begin(), sorted.begin() + p99Index, sorted.end());
+
+    summary.minMs = stats.min;
+    summary.avgMs = stats.sum / stats.count;
+    summary.p99Ms = sorted[p99Index];
+    summary.count = stats.count;
+    return summary;
+}
+
+bool GpuProfiler::GetFrameSample(uint32_t frameInFlight, const std::string& name, double& ms) const
+{
+    const auto& collected = m_frames[frameInFlight].collected;
+    auto it = collected.find(name);
+    if (it == collected.end())
+        return false;
+
+    ms = it->second;
+    return true;
+}
+
+void GpuProfiler::PrintStatistics() const
+{
+    if (m_statistics.empty())
+        return;
+
+    std::cout << "GPU timings (ms)         min       avg       p99" << std::endl;
+    for (auto& entry : m_statistics)
+    {
+        ScopeSummary summary = GetSummary(entry.first);
+
+        std::cout << "  " << std::left << std::setw(20) << entry.first << std::right << std::fixed << std::setprecision(4)
+            << std::setw(10) << summary.minMs
+            << std::setw(10) << summary.avgMs
+            << std::setw(10) << summary.p99Ms << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
@@ -1,11 +1,15 @@
-#include "..\inc\GraphicsTask.h"
+#include "GraphicsTask.h"
+#include "EmbeddedShaders.h"
+#include "FrameStats.h"
 #include <array>
 
 
-GraphicsTask::GraphicsTask(const VkDevice& device, const VkPhysicalDevice& physicalDevice, const VkQueue & graphicsQueue, uint32_t queueFamilyIndex,
-    uint32_t maxFrameInFlight, uint32_t screenWidth, uint32_t screenHeight):
-    m_graphicsQueue(graphicsQueue), m_device(device), m_screenWidth(screenWidth), m_screenHeight(screenHeight),
-    m_maxFrameInFlights(maxFrameInFlight)
+GraphicsTask::GraphicsTask(const VkDevice& device, MemoryAllocator& allocator, const VkPipelineCache& pipelineCache, GpuProfiler& profiler,
+    ImmediateSubmitContext& immediateContext, const VkQueue & graphicsQueue, uint32_t queueFamilyIndex,
+    uint32_t maxFrameInFlight, uint32_t screenWidth, uint32_t screenHeight, const std::vector<VkImageView>& sampledImageViews):
+    m_graphicsQueue(graphicsQueue), m_device(device), m_allocator(allocator), m_profiler(profiler), m_immediateContext(immediateContext),
+    m_queueFamilyIndex(queueFamilyIndex), m_screenWidth(screenWidth), m_screenHeight(screenHeight),
+    m_maxFrameInFlights(maxFrameInFlight), m_dirtyMasks(maxFrameInFlight, DIRTY_ALL), m_pendingResize(maxFrameInFlight, false)
 {
     VkCommandPoolCreateInfo createInfo{};
     createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
@@ -23,39 +27,94 @@ GraphicsTask::GraphicsTask(const VkDevice& device, const VkPhysicalDevice& physi
 
     ErrorCheck(vkAllocateCommandBuffers(device, &alloc_info, &m_commandBuffers[0]));
 
-    /*VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    // Descriptors for sampling the compute output
+    {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.maxLod = 1.0f;
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+
+        ErrorCheck(vkCreateSampler(device, &samplerInfo, nullptr, &m_sampler));
+
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = 0;
+        binding.descriptorCount = 1;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.bindingCount = 1;
+        layoutInfo.pBindings = &binding;
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+
+        ErrorCheck(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout));
+
+        VkDescriptorPoolSize poolSize{};
+        poolSize.descriptorCount = maxFrameInFlight;
+        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.maxSets = maxFrameInFlight;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+
+        ErrorCheck(vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool));
+
+        std::vector<VkDescriptorSetLayout> layouts(maxFrameInFlight, m_descriptorSetLayout);
+        m_descriptorSets.resize(maxFrameInFlight);
+
+        VkDescriptorSetAllocateInfo setAllocInfo{};
+        setAllocInfo.descriptorPool = m_descriptorPool;
+        setAllocInfo.descriptorSetCount = maxFrameInFlight;
+        setAllocInfo.pSetLayouts = layouts.data();
+        setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+
+        ErrorCheck(vkAllocateDescriptorSets(device, &setAllocInfo, m_descriptorSets.data()));
+
+        for (uint32_t i = 0; i < maxFrameInFlight; i++)
+        {
+            // The compute task keeps its storage images in GENERAL layout
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            imageInfo.imageView = sampledImageViews[i];
+            imageInfo.sampler = m_sampler;
+
+            VkWriteDescriptorSet write{};
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.dstBinding = 0;
+            write.dstSet = m_descriptorSets[i];
+            write.pImageInfo = &imageInfo;
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+
+            vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        }
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
     pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
-    pipelineLayoutCreateInfo.pSetLayouts = &sampledLayout;
+    pipelineLayoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
     pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
     pipelineLayoutCreateInfo.setLayoutCount = 1;
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 
-    ErrorCheck(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));*/
+    ErrorCheck(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout));
 
     // Render pass attachments
+    m_colorAttachments.resize(maxFrameInFlight);
+    m_colorAttachmentMemory.resize(maxFrameInFlight);
     m_colorAttachmentViews.resize(maxFrameInFlight);
-    for (int i = 0; i < maxFrameInFlight; ++i)
-    {
-        auto[image, memory] = CreateImage(device, physicalDevice, screenWidth, screenHeight, VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT| VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
-        m_colorAttachments.push_back(std::move(image));
-        m_colorAttachmentMemory.push_back(std::move(memory));
-
-        VkImageViewCreateInfo createInfo{};
-        createInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY };
-        createInfo.format = VK_FORMAT_B8G8R8A8_UNORM;
-        createInfo.image = m_colorAttachments[i];
-        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        createInfo.subresourceRange.baseArrayLayer = 0;
-        createInfo.subresourceRange.baseMipLevel = 0;
-        createInfo.subresourceRange.layerCount = 1;
-        createInfo.subresourceRange.levelCount = 1;
-        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-
-        ErrorCheck(vkCreateImageView(device, &createInfo, nullptr, &m_colorAttachmentViews[i]));
-    }
+    for (uint32_t i = 0; i < maxFrameInFlight; ++i)
+        CreateColorAttachment(i);
 
-    ChangeImageLayout(m_device, m_colorAttachments, m_graphicsQueue, queueFamilyIndex, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    // Start out the way VulkanManager::CopyAndPresent leaves them, so every frame records the same barrier
+    ChangeImageLayout(immediateContext.Begin(), m_colorAttachments, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
 
     //Render pass
     VkClearValue clearValues{ VkClearColorValue{0.7f, 0.2f, 0.5f, 1.0f} };
@@ -88,11 +147,10 @@ GraphicsTask::GraphicsTask(const VkDevice& device, const VkPhysicalDevice& physi
     pipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
 
     // Create pipeline
-    /*std::string vertSpvPath = std::string{ SPV_PATH } +"FullScreenQuadVert.spv";
-    std::string fragSpvPath = std::string{ SPV_PATH } +"FullScreenQuadFrag.spv";
-
-    auto[vertShaderModule, vertShaderStage] = CreateShaderModule(device, vertSpvPath, VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT);
-    auto[fragShaderModule, fragShaderStage] = CreateShaderModule(device, fragSpvPath, VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT);
+    auto[vertShaderModule, vertShaderStage] = CreateShaderModule(device, EmbeddedShaders::FullScreenQuadVert, sizeof(EmbeddedShaders::FullScreenQuadVert),
+        VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT);
+    auto[fragShaderModule, fragShaderStage] = CreateShaderModule(device, EmbeddedShaders::FullScreenQuadFrag, sizeof(EmbeddedShaders::FullScreenQuadFrag),
+        VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT);
 
     m_vertexShaderModule = vertShaderModule;
     m_fragmentShaderModule = fragShaderModule;
@@ -182,27 +240,71 @@ GraphicsTask::GraphicsTask(const VkDevice& device, const VkPhysicalDevice& physi
     graphicsPipelineCreateInfo.stageCount = 2;
     graphicsPipelineCreateInfo.pNext = &pipelineRenderingCreateInfo;
 
-    ErrorCheck( vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo,
-        nullptr, &m_pipeline));*/
+    ErrorCheck( vkCreateGraphicsPipelines(device, pipelineCache, 1, &graphicsPipelineCreateInfo,
+        nullptr, &m_pipeline));
+
+    m_profileScope = m_profiler.ReserveScope("FullScreenQuad");
 }
 
 GraphicsTask::~GraphicsTask()
 {
     vkDestroyCommandPool(m_device, m_commandPool, nullptr);
-    //vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
-    //vkDestroyShaderModule(m_device, m_vertexShaderModule, nullptr);
-    //vkDestroyShaderModule(m_device, m_fragmentShaderModule, nullptr);
-    //vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+    vkDestroyShaderModule(m_device, m_vertexShaderModule, nullptr);
+    vkDestroyShaderModule(m_device, m_fragmentShaderModule, nullptr);
+    vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+    vkDestroySampler(m_device, m_sampler, nullptr);
 
     for (uint32_t i = 0; i < m_colorAttachments.size(); i++)
-    {
-        vkDestroyImageView(m_device, m_colorAttachmentViews[i], nullptr);
-        vkFreeMemory(m_device, m_colorAttachmentMemory[i], nullptr);
-        vkDestroyImage(m_device, m_colorAttachments[i], nullptr);
-    }
+        DestroyColorAttachment(i);
 }
 
-void GraphicsTask::BuildCommandBuffers(const uint32_t & frameInFlight, bool changeImageLayout)
+void GraphicsTask::CreateColorAttachment(const uint32_t& frameInFlight)
+{
+    auto[image, memory] = CreateImage(m_device, m_allocator, m_screenWidth, m_screenHeight, VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT| VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    m_colorAttachments[frameInFlight] = image;
+    m_colorAttachmentMemory[frameInFlight] = memory;
+
+    VkImageViewCreateInfo createInfo{};
+    createInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY };
+    createInfo.format = VK_FORMAT_B8G8R8A8_UNORM;
+    createInfo.image = m_colorAttachments[frameInFlight];
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    createInfo.subresourceRange.baseArrayLayer = 0;
+    createInfo.subresourceRange.baseMipLevel = 0;
+    createInfo.subresourceRange.layerCount = 1;
+    createInfo.subresourceRange.levelCount = 1;
+    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+    ErrorCheck(vkCreateImageView(m_device, &createInfo, nullptr, &m_colorAttachmentViews[frameInFlight]));
+}
+
+void GraphicsTask::DestroyColorAttachment(const uint32_t& frameInFlight)
+{
+    vkDestroyImageView(m_device, m_colorAttachmentViews[frameInFlight], nullptr);
+    m_allocator.Free(m_colorAttachmentMemory[frameInFlight]);
+    vkDestroyImage(m_device, m_colorAttachments[frameInFlight], nullptr);
+}
+
+void GraphicsTask::Resize(uint32_t screenWidth, uint32_t screenHeight)
+{
+    if (screenWidth == m_screenWidth && screenHeight == m_screenHeight)
+        return;
+
+    m_screenWidth = screenWidth;
+    m_screenHeight = screenHeight;
+
+    // Other frames in flight may still be rendering into / copying from their attachment, each one is replaced
+    // the next time its frame comes around in Update()
+    for (uint32_t i = 0; i < m_maxFrameInFlights; i++)
+        m_pendingResize[i] = true;
+    MarkDirty(DIRTY_VIEWPORT | DIRTY_ATTACHMENTS);
+}
+
+void GraphicsTask::BuildCommandBuffers(const uint32_t & frameInFlight)
 {
     VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(m_screenWidth), static_cast<float>(m_screenHeight), 0.0f, 1.0f };
     VkRect2D   scissor = { {0, 0}, {m_screenWidth, m_screenHeight} };
@@ -221,13 +323,13 @@ void GraphicsTask::BuildCommandBuffers(const uint32_t & frameInFlight, bool chan
 
     ErrorCheck(vkResetCommandBuffer(m_commandBuffers[frameInFlight], 0));
 
+    // Resubmitted every time this frame in flight comes around, so no ONE_TIME_SUBMIT
     VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.flags = 0;
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
     ErrorCheck(vkBeginCommandBuffer(m_commandBuffers[frameInFlight], &beginInfo));
 
-    if (changeImageLayout)
     {
         VkImageMemoryBarrier image_barrier2{};
         image_barrier2.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -244,6 +346,30 @@ void GraphicsTask::BuildCommandBuffers(const uint32_t & frameInFlight, bool chan
             0, 0, nullptr, 0, nullptr, 1, &image_barrier2);
     }
 
+    if (m_acquireQueueFamily != VK_QUEUE_FAMILY_IGNORED)
+    {
+        // Matches the compute task's release. The source stage is the one the timeline wait blocks, so the acquire
+        // is ordered after the release; the source access is ignored for an acquire.
+        VkImageMemoryBarrier2 acquireBarrier{};
+        acquireBarrier.image = m_sampledImages[frameInFlight];
+        acquireBarrier.srcQueueFamilyIndex = m_acquireQueueFamily;
+        acquireBarrier.dstQueueFamilyIndex = m_queueFamilyIndex;
+        acquireBarrier.srcStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        acquireBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+        acquireBarrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        acquireBarrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        acquireBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        acquireBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        acquireBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        acquireBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+
+        VkDependencyInfo dependencyInfo{};
+        dependencyInfo.imageMemoryBarrierCount = 1;
+        dependencyInfo.pImageMemoryBarriers = &acquireBarrier;
+        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        vkCmdPipelineBarrier2(m_commandBuffers[frameInFlight], &dependencyInfo);
+    }
+
     VkClearValue clears = {};
     clears.color.float32[0] = 0.033f;
     clears.color.float32[1] = 0.073f;
@@ -264,30 +390,55 @@ void GraphicsTask::BuildCommandBuffers(const uint32_t & frameInFlight, bool chan
     renderingInfo.renderArea = { {0,0}, {m_screenWidth, m_screenHeight} };
     renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
 
-    vkCmdBeginRendering(m_commandBuffers[frameInFlight], &renderingInfo);
+    {
+        GpuProfileScope profileScope(m_profiler, m_commandBuffers[frameInFlight], frameInFlight, m_profileScope);
 
-    //vkCmdBindPipeline(m_commandBuffers[frameInFlight], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
-    vkCmdSetViewport(m_commandBuffers[frameInFlight], 0, 1, &viewport);
-    vkCmdSetScissor(m_commandBuffers[frameInFlight], 0, 1, &scissor);
+        vkCmdBeginRendering(m_commandBuffers[frameInFlight], &renderingInfo);
 
-    //vkCmdBindDescriptorSets(m_commandBuffers[frameInFlight], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_sampledDescriptorSets[frameInFlight], 0, nullptr);
-    //vkCmdDraw(m_commandBuffers[frameInFlight], 3, 1, 0, 0);
+        vkCmdBindPipeline(m_commandBuffers[frameInFlight], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+        vkCmdSetViewport(m_commandBuffers[frameInFlight], 0, 1, &viewport);
+        vkCmdSetScissor(m_commandBuffers[frameInFlight], 0, 1, &scissor);
 
-    vkCmdEndRendering(m_commandBuffers[frameInFlight]);
+        vkCmdBindDescriptorSets(m_commandBuffers[frameInFlight], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[frameInFlight], 0, nullptr);
+        vkCmdDraw(m_commandBuffers[frameInFlight], 3, 1, 0, 0);
+
+        vkCmdEndRendering(m_commandBuffers[frameInFlight]);
+    }
 
     ErrorCheck(vkEndCommandBuffer(m_commandBuffers[frameInFlight]));
 }
 
-void GraphicsTask::Update(const uint32_t & frameIndex, const uint32_t & frameInFlight,
-    const VkSemaphore& timelineSem, uint64_t signalValue, uint64_t waitValue)
+void GraphicsTask::Update(const uint32_t & frameInFlight, const VkSemaphore& timelineSem, uint64_t signalValue, uint64_t waitValue)
 {
-    if(frameIndex > 1)
-        BuildCommandBuffers(frameInFlight, true);
-    else
-        BuildCommandBuffers(frameInFlight, false);
+    // The host waited for this frame in flight's previous SAFE_TO_PRESENT, nothing uses its attachment anymore
+    bool waitForAttachment = false;
+    ImmediateSubmitContext::Ticket attachmentTicket = 0;
+    if (m_pendingResize[frameInFlight])
+    {
+        DestroyColorAttachment(frameInFlight);
+        CreateColorAttachment(frameInFlight);
+
+        ChangeImageLayout(m_immediateContext.Begin(), { m_colorAttachments[frameInFlight] },
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        attachmentTicket = m_immediateContext.Submit();
+        waitForAttachment = true;
+        m_pendingResize[frameInFlight] = false;
+    }
+
+    if (m_dirtyMasks[frameInFlight] != 0)
+    {
+        FRAME_STATS_SCOPE(RECORD);
+        BuildCommandBuffers(frameInFlight);
+        m_dirtyMasks[frameInFlight] = 0;
+        m_recordCount++;
+    }
 
-    VkSemaphoreSubmitInfo waitInfo
-    { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, timelineSem, waitValue, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0 };
+    // The fragment shader samples what the compute task wrote for this frame
+    // A freshly created attachment also waits for its layout transition
+    VkSemaphoreSubmitInfo waitInfo[2]{
+        { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, timelineSem, waitValue, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, 0 },
+        { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, m_immediateContext.GetSemaphore(), attachmentTicket, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 0 }
+    };
 
     VkSemaphoreSubmitInfo signalInfo
     { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, timelineSem, signalValue, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 };
@@ -301,16 +452,36 @@ void GraphicsTask::Update(const uint32_t & frameIndex, const uint32_t & frameInF
     submitInfo.commandBufferInfoCount = 1;
     submitInfo.pCommandBufferInfos = &bufInfo;
     submitInfo.pSignalSemaphoreInfos = &signalInfo;
-    //submitInfo.pWaitSemaphoreInfos = &waitInfo;
+    submitInfo.pWaitSemaphoreInfos = waitInfo;
     submitInfo.signalSemaphoreInfoCount = 1;
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
-    //submitInfo.waitSemaphoreInfoCount = 1;
+    submitInfo.waitSemaphoreInfoCount = waitForAttachment ? 2 : 1;
 
     // If the threads are being killed, we need to skip the queue submission to allow the program to exit gracefully
     //if (m_alive)
     {
+        FRAME_STATS_SCOPE(SUBMIT);
         ErrorCheck(vkQueueSubmit2(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
     }
+    m_profiler.SubmitReservedScope(frameInFlight, m_profileScope);
+}
+
+void GraphicsTask::SetAcquireQueueFamily(uint32_t srcQueueFamilyIndex, const std::vector<VkImage>& sampledImages)
+{
+    m_acquireQueueFamily = srcQueueFamilyIndex == m_queueFamilyIndex ? VK_QUEUE_FAMILY_IGNORED : srcQueueFamilyIndex;
+    m_sampledImages = sampledImages;
+    MarkDirty(DIRTY_DESCRIPTORS);
+}
+
+void GraphicsTask::MarkDirty(uint32_t dirtyBits)
+{
+    for (auto& mask : m_dirtyMasks)
+        mask |= dirtyBits;
+}
+
+uint64_t GraphicsTask::GetRecordCount() const
+{
+    return m_recordCount;
 }
 
 const std::vector<VkImage>& GraphicsTask::GetColorAttachments()
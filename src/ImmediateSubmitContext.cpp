@@ -0,0 +1,148 @@
+#include "ImmediateSubmitContext.h"
+#include "Utils.h"
+
+ImmediateSubmitContext::ImmediateSubmitContext(const VkDevice& device, const VkQueue& queue, uint32_t queueFamilyIndex) :
+    m_device(device), m_queue(queue)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+
+    ErrorCheck(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    VkSemaphoreTypeCreateInfo typeCreateInfo{};
+    typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeCreateInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeCreateInfo;
+
+    ErrorCheck(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore));
+}
+
+ImmediateSubmitContext::~ImmediateSubmitContext()
+{
+    // Anything recorded but never submitted is simply dropped
+    Wait(m_lastSubmittedTicket);
+
+    vkDestroySemaphore(m_device, m_semaphore, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+}
+
+void ImmediateSubmitContext::Recycle()
+{
+    if (m_inFlightCommandBuffers.empty())
+        return;
+
+    uint64_t completedValue = 0;
+    ErrorCheck(vkGetSemaphoreCounterValue(m_device, m_semaphore, &completedValue));
+
+    while (!m_inFlightCommandBuffers.empty() && m_inFlightCommandBuffers.front().ticket <= completedValue)
+    {
+        m_freeCommandBuffers.push_back(m_inFlightCommandBuffers.front().commandBuffer);
+        m_inFlightCommandBuffers.pop_front();
+    }
+}
+
+VkCommandBuffer ImmediateSubmitContext::Begin()
+{
+    if (m_recordingCommandBuffer != VK_NULL_HANDLE)
+        return m_recordingCommandBuffer;
+
+    Recycle();
+
+    if (m_freeCommandBuffers.empty())
+    {
+        m_recordingCommandBuffer = AllocateCommandBuffer(m_device, m_commandPool);
+    }
+    else
+    {
+        m_recordingCommandBuffer = m_freeCommandBuffers.back();
+        m_freeCommandBuffers.pop_back();
+        ErrorCheck(vkResetCommandBuffer(m_recordingCommandBuffer, 0));
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    ErrorCheck(vkBeginCommandBuffer(m_recordingCommandBuffer, &beginInfo));
+    return m_recordingCommandBuffer;
+}
+
+ImmediateSubmitContext::Ticket ImmediateSubmitContext::Submit()
+{
+    if (m_recordingCommandBuffer == VK_NULL_HANDLE)
+        return m_lastSubmittedTicket;
+
+    ErrorCheck(vkEndCommandBuffer(m_recordingCommandBuffer));
+
+    const Ticket ticket = m_lastSubmittedTicket + 1;
+
+    VkCommandBufferSubmitInfo cmdBufferInfo{};
+    cmdBufferInfo.commandBuffer = m_recordingCommandBuffer;
+    cmdBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+
+    VkSemaphoreSubmitInfo signalInfo{};
+    signalInfo.semaphore = m_semaphore;
+    signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    signalInfo.value = ticket;
+    signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+
+    VkSubmitInfo2 submitInfo{};
+    submitInfo.commandBufferInfoCount = 1;
+    submitInfo.pCommandBufferInfos = &cmdBufferInfo;
+    submitInfo.signalSemaphoreInfoCount = 1;
+    submitInfo.pSignalSemaphoreInfos = &signalInfo;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+
+    ErrorCheck(vkQueueSubmit2(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+    m_inFlightCommandBuffers.push_back({ m_recordingCommandBuffer, ticket });
+    m_recordingCommandBuffer = VK_NULL_HANDLE;
+    m_lastSubmittedTicket = ticket;
+    m_submitCount++;
+
+    return ticket;
+}
+
+void ImmediateSubmitContext::Wait(Ticket ticket)
+{
+    assert(ticket <= m_lastSubmittedTicket);
+    if (ticket == 0)
+        return;
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &ticket;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+
+    ErrorCheck(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+    Recycle();
+}
+
+bool ImmediateSubmitContext::IsComplete(Ticket ticket)
+{
+    uint64_t completedValue = 0;
+    ErrorCheck(vkGetSemaphoreCounterValue(m_device, m_semaphore, &completedValue));
+    return completedValue >= ticket;
+}
+
+void ImmediateSubmitContext::SubmitAndWait()
+{
+    Wait(Submit());
+}
+
+const VkSemaphore& ImmediateSubmitContext::GetSemaphore() const
+{
+    return m_semaphore;
+}
+
+uint64_t ImmediateSubmitContext::GetSubmitCount() const
+{
+    return m_submitCount;
+}
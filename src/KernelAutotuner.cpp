@@ -0,0 +1,207 @@
+#include "KernelAutotuner.h"
+#include "VulkanManager.h"
+#include "FrameRing.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+    constexpr uint32_t WARMUP_FRAMES = 3;
+    constexpr uint32_t TIMED_FRAMES = 10;
+
+    // Whole set in view, a mix of escaping and interior (max iteration) pixels
+    const MandlebrotView TUNING_VIEW{};
+
+    const std::pair<uint32_t, uint32_t> WORKGROUP_SHAPES[] = {
+        { 8, 8 }, { 16, 8 }, { 8, 16 }, { 16, 16 }, { 32, 8 }, { 8, 32 }, { 32, 16 }, { 32, 32 },
+        { 64, 1 }, { 64, 4 }, { 128, 1 }, { 256, 1 }
+    };
+    const uint32_t UNROLL_FACTORS[] = { 1, 2, 4, 8 };
+
+    std::string GetAutotuneFilePath()
+    {
+        return std::string(CACHE_PATH) + "autotune.txt";
+    }
+}
+
+KernelAutotuner::KernelAutotuner(VulkanManager& vulkanManager, uint32_t imageWidth, uint32_t imageHeight) :
+    m_vulkanManager(vulkanManager), m_imageWidth(imageWidth), m_imageHeight(imageHeight)
+{
+    VkPhysicalDeviceIDProperties idProperties{};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties2(m_vulkanManager.GetPhysicalDevice(), &properties2);
+
+    std::ostringstream key;
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+        key << std::hex << std::setw(2) << std::setfill('0') << (uint32_t)idProperties.deviceUUID[i];
+    m_deviceKey = key.str();
+
+    m_driverVersion = properties2.properties.driverVersion;
+    m_maxWorkGroupSize[0] = properties2.properties.limits.maxComputeWorkGroupSize[0];
+    m_maxWorkGroupSize[1] = properties2.properties.limits.maxComputeWorkGroupSize[1];
+    m_maxWorkGroupInvocations = properties2.properties.limits.maxComputeWorkGroupInvocations;
+}
+
+std::vector<MandlebrotSettings> KernelAutotuner::GetCandidates(const MandlebrotSettings& base) const
+{
+    std::vector<MandlebrotSettings> candidates;
+    for (const auto& shape : WORKGROUP_SHAPES)
+    {
+        if (shape.first > m_maxWorkGroupSize[0] || shape.second > m_maxWorkGroupSize[1] ||
+            shape.first * shape.second > m_maxWorkGroupInvocations)
+            continue;
+
+        for (uint32_t unroll : UNROLL_FACTORS)
+        {
+            MandlebrotSettings settings = base;
+            settings.workgroupSizeX = shape.first;
+            settings.workgroupSizeY = shape.second;
+            settings.unroll = unroll;
+            // Only the float kernel gets tuned, the df64 one reuses its shape
+            settings.precision = MandlebrotPrecision::FLOAT;
+            // Tuned on the grid kernel, MandlebrotTiles.comp has a fixed workgroup size anyway
+            settings.kernel = MandlebrotKernel::GRID;
+            // Culling skips most of the work inside the set, the shape has to be picked on the full loop
+            settings.interiorCulling = false;
+            // GPU only, a CPU share would mix the host's speed into the timings
+            settings.hybridCpu = false;
+            candidates.push_back(settings);
+        }
+    }
+    return candidates;
+}
+
+double KernelAutotuner::Measure(const MandlebrotSettings& settings)
+{
+    GpuProfiler& profiler = m_vulkanManager.GetGpuProfiler();
+    const uint32_t framesInFlight = m_vulkanManager.GetMaxFramesInFlight();
+
+    ComputeTask task(m_vulkanManager.GetLogicalDevice(), m_vulkanManager.GetMemoryAllocator(), m_vulkanManager.GetPipelineCache(),
+        profiler, m_vulkanManager.GetImmediateSubmitContext(), m_vulkanManager.GetComputeQueue(), m_vulkanManager.GetComputeQueueFamilyIndex(),
+        framesInFlight, m_imageWidth, m_imageHeight, settings);
+    m_vulkanManager.GetImmediateSubmitContext().SubmitAndWait();
+
+    FrameRing frameRing(m_vulkanManager.GetLogicalDevice(), framesInFlight, COMPUTE_FINISHED);
+    auto RunFrames = [&](uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            FrameRing::Frame frame = frameRing.BeginFrame();
+            if (frame.slotRetired)
+                profiler.Collect(frame.slot);
+
+            task.Update((uint32_t)frame.index, frame.slot, frame.timeline.GetSemaphore(),
+                frame.timeline.GetTimelineValue(TimelineStages::COMPUTE_FINISHED), TUNING_VIEW);
+            frameRing.EndFrame();
+        }
+        frameRing.WaitIdle();
+        for (uint32_t i = 0; i < framesInFlight; i++)
+            profiler.Collect(i);
+    };
+
+    RunFrames(WARMUP_FRAMES);
+    profiler.ResetStatistics();
+
+    auto begin = std::chrono::steady_clock::now();
+    RunFrames(TIMED_FRAMES);
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / TIMED_FRAMES;
+
+    // Wall time per frame when timestamps aren't available
+    GpuProfiler::ScopeSummary summary = profiler.GetSummary("Mandlebrot");
+    return summary.count > 0 ? summary.avgMs : wallMs;
+}
+
+bool KernelAutotuner::Load(MandlebrotSettings& settings) const
+{
+    std::ifstream file(GetAutotuneFilePath());
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // <device uuid> <driver version> <workgroup x> <workgroup y> <unroll> <gpu ms>
+        std::istringstream stream(line);
+        std::string key;
+        uint32_t driverVersion = 0, workgroupSizeX = 0, workgroupSizeY = 0, unroll = 0;
+        if (!(stream >> key >> driverVersion >> workgroupSizeX >> workgroupSizeY >> unroll))
+            continue;
+
+        // A driver update can change what's fastest, tune again
+        if (key != m_deviceKey || driverVersion != m_driverVersion)
+            continue;
+
+        if (workgroupSizeX == 0 || workgroupSizeY == 0 || unroll == 0 || workgroupSizeX * workgroupSizeY > m_maxWorkGroupInvocations)
+            return false;
+
+        settings.workgroupSizeX = workgroupSizeX;
+        settings.workgroupSizeY = workgroupSizeY;
+        settings.unroll = unroll;
+        return true;
+    }
+    return false;
+}
+
+void KernelAutotuner::Save(const MandlebrotSettings& settings, double gpuMs) const
+{
+    // Keep the other devices' lines, the key is the first field
+    auto IsOtherDevice = [this](const std::string& line)
+    {
+        std::string key;
+        return !(std::istringstream(line) >> key) || key != m_deviceKey;
+    };
+
+    std::ostringstream line;
+    line << m_deviceKey << " " << m_driverVersion << " " << settings.workgroupSizeX << " " << settings.workgroupSizeY << " "
+        << settings.unroll << " " << gpuMs;
+
+    if (!RewriteLines(GetAutotuneFilePath(), IsOtherDevice, { line.str() }))
+        std::cout << "Autotune : could not write " << GetAutotuneFilePath() << std::endl;
+}
+
+MandlebrotSettings KernelAutotuner::LoadOrTune(const MandlebrotSettings& base, bool retune)
+{
+    MandlebrotSettings settings = base;
+    if (!retune && Load(settings))
+    {
+        std::cout << "Autotune : " << settings.workgroupSizeX << "x" << settings.workgroupSizeY << " unroll " << settings.unroll
+            << " (from " << GetAutotuneFilePath() << ")" << std::endl;
+        return settings;
+    }
+    return Tune(base);
+}
+
+MandlebrotSettings KernelAutotuner::Tune(const MandlebrotSettings& base)
+{
+    std::vector<MandlebrotSettings> candidates = GetCandidates(base);
+    std::cout << "Autotune : timing " << candidates.size() << " kernel variants at " << m_imageWidth << "x" << m_imageHeight << std::endl;
+
+    MandlebrotSettings best = base;
+    double bestMs = std::numeric_limits<double>::max();
+    for (const auto& candidate : candidates)
+    {
+        double ms = Measure(candidate);
+        std::cout << "    " << candidate.workgroupSizeX << "x" << candidate.workgroupSizeY << " unroll " << candidate.unroll
+            << " : " << ms << " ms" << std::endl;
+
+        if (ms < bestMs)
+        {
+            bestMs = ms;
+            best.workgroupSizeX = candidate.workgroupSizeX;
+            best.workgroupSizeY = candidate.workgroupSizeY;
+            best.unroll = candidate.unroll;
+        }
+    }
+
+    // Tuning samples shouldn't show up in the application's statistics
+    m_vulkanManager.GetGpuProfiler().ResetStatistics();
+
+    std::cout << "Autotune : fastest is " << best.workgroupSizeX << "x" << best.workgroupSizeY << " unroll " << best.unroll
+        << " (" << bestMs << " ms)" << std::endl;
+    Save(best, bestMs);
+    return best;
+}
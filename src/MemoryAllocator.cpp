@@ -0,0 +1,304 @@
+#include "MemoryAllocator.h"
+#include "Utils.h"
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <optional>
+
+namespace
+{
+    VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // True when the last byte of resource A and the first byte of resource B land on the same granularity page
+    bool OnSamePage(VkDeviceSize resourceAOffset, VkDeviceSize resourceASize, VkDeviceSize resourceBOffset, VkDeviceSize pageSize)
+    {
+        VkDeviceSize resourceAEndPage = (resourceAOffset + resourceASize - 1) & ~(pageSize - 1);
+        VkDeviceSize resourceBStartPage = resourceBOffset & ~(pageSize - 1);
+        return resourceAEndPage == resourceBStartPage;
+    }
+}
+
+MemoryAllocator::MemoryAllocator(const VkDevice& device, const VkPhysicalDevice& physicalDevice, VkDeviceSize preferredBlockSize) :
+    m_device(device), m_preferredBlockSize(preferredBlockSize)
+{
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+    VkPhysicalDeviceProperties deviceProp{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProp);
+    m_bufferImageGranularity = std::max<VkDeviceSize>(1, deviceProp.limits.bufferImageGranularity);
+
+    m_blocks.resize(m_memoryProperties.memoryTypeCount);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    for (auto& blockList : m_blocks)
+    {
+        for (auto& block : blockList)
+        {
+            if (!block->allocations.empty())
+            {
+                std::cout << "MemoryAllocator : " << block->allocations.size() << " sub-allocation(s) leaked" << std::endl;
+            }
+            DestroyBlock(*block);
+        }
+    }
+    m_blocks.clear();
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags) const
+{
+    std::optional<uint32_t> fallback;
+    for (uint32_t i = 0u; i < m_memoryProperties.memoryTypeCount; ++i)
+    {
+        // Is this kind of memory suitable for our resource?
+        if (0 == (memoryTypeBits & (1u << i)))
+        {
+            continue;
+        }
+
+        const auto flags = m_memoryProperties.memoryTypes[i].propertyFlags;
+        if ((flags & requiredFlags) != requiredFlags)
+        {
+            continue;
+        }
+
+        if ((flags & preferredFlags) == preferredFlags)
+        {
+            return i;
+        }
+
+        if (!fallback.has_value())
+        {
+            fallback = i;
+        }
+    }
+
+    if (!fallback.has_value())
+    {
+        throw std::runtime_error("Couldn't find suitable memory.");
+    }
+    return fallback.value();
+}
+
+const VkMemoryType& MemoryAllocator::GetMemoryType(uint32_t memoryTypeIndex) const
+{
+    return m_memoryProperties.memoryTypes[memoryTypeIndex];
+}
+
+bool MemoryAllocator::TryAllocateFromBlock(Block& block, const VkMemoryRequirements& memoryRequirements, bool linear, VkDeviceSize& offset) const
+{
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(1, memoryRequirements.alignment);
+    const VkDeviceSize size = memoryRequirements.size;
+
+    // Places the request in the gap [gapBegin, gapEnd) given the sub-allocations surrounding it (either can be null)
+    auto FitInGap = [&](VkDeviceSize gapBegin, VkDeviceSize gapEnd,
+        const std::pair<const VkDeviceSize, SubAllocation>* prev, const std::pair<const VkDeviceSize, SubAllocation>* next) -> bool
+    {
+        VkDeviceSize candidate = AlignUp(gapBegin, alignment);
+
+        if (prev != nullptr && prev->second.linear != linear &&
+            OnSamePage(prev->first, prev->second.size, candidate, m_bufferImageGranularity))
+        {
+            candidate = AlignUp(candidate, m_bufferImageGranularity);
+        }
+
+        if (candidate + size > gapEnd)
+            return false;
+
+        if (next != nullptr && next->second.linear != linear &&
+            OnSamePage(candidate, size, next->first, m_bufferImageGranularity))
+        {
+            return false;
+        }
+
+        offset = candidate;
+        return true;
+    };
+
+    // Linear fast path, bump onto the tail of the block
+    if (block.allocations.empty())
+    {
+        return FitInGap(0, block.size, nullptr, nullptr);
+    }
+
+    auto& last = *block.allocations.rbegin();
+    if (FitInGap(last.first + last.second.size, block.size, &last, nullptr))
+    {
+        return true;
+    }
+
+    // First fit into the gaps left behind by freed sub-allocations
+    VkDeviceSize gapBegin = 0;
+    const std::pair<const VkDeviceSize, SubAllocation>* prev = nullptr;
+    for (auto& entry : block.allocations)
+    {
+        if (entry.first > gapBegin && FitInGap(gapBegin, entry.first, prev, &entry))
+        {
+            return true;
+        }
+        gapBegin = entry.first + entry.second.size;
+        prev = &entry;
+    }
+
+    return false;
+}
+
+MemoryAllocator::Block* MemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated)
+{
+    auto block = std::make_unique<Block>();
+    block->size = size;
+    block->dedicated = dedicated;
+
+    VkMemoryAllocateInfo memoryAllocInfo = {};
+    memoryAllocInfo.allocationSize = size;
+    memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
+    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    ErrorCheck(vkAllocateMemory(m_device, &memoryAllocInfo, nullptr, &block->memory));
+
+    // Host visible blocks stay mapped for their whole lifetime
+    if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        ErrorCheck(vkMapMemory(m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mappedData));
+    }
+
+    m_blocks[memoryTypeIndex].push_back(std::move(block));
+    return m_blocks[memoryTypeIndex].back().get();
+}
+
+void MemoryAllocator::DestroyBlock(Block& block)
+{
+    if (block.mappedData != nullptr)
+    {
+        vkUnmapMemory(m_device, block.memory);
+        block.mappedData = nullptr;
+    }
+    vkFreeMemory(m_device, block.memory, nullptr);
+    block.memory = VK_NULL_HANDLE;
+}
+
+MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags requiredFlags,
+    VkMemoryPropertyFlags preferredFlags, bool linear)
+{
+    uint32_t memoryTypeIndex = FindMemoryType(memoryRequirements.memoryTypeBits, requiredFlags, preferredFlags);
+
+    // Never let a single block eat up a large share of a small heap
+    const VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+    const VkDeviceSize blockSize = std::min(m_preferredBlockSize, std::max<VkDeviceSize>(heapSize / 8, 1));
+
+    Block* targetBlock = nullptr;
+    VkDeviceSize offset = 0;
+
+    if (memoryRequirements.size > blockSize / 2)
+    {
+        // Big resources get a block of their own, it is released as soon as the resource is freed
+        targetBlock = CreateBlock(memoryTypeIndex, memoryRequirements.size, true);
+    }
+    else
+    {
+        for (auto& block : m_blocks[memoryTypeIndex])
+        {
+            if (!block->dedicated && TryAllocateFromBlock(*block, memoryRequirements, linear, offset))
+            {
+                targetBlock = block.get();
+                break;
+            }
+        }
+
+        if (targetBlock == nullptr)
+        {
+            // Never smaller than the request, blockSize may be tuned below it
+            targetBlock = CreateBlock(memoryTypeIndex, std::max(blockSize, memoryRequirements.size + memoryRequirements.alignment), false);
+            if (!TryAllocateFromBlock(*targetBlock, memoryRequirements, linear, offset))
+                throw std::runtime_error("Allocation doesn't fit into a new memory block.");
+        }
+    }
+
+    targetBlock->allocations[offset] = SubAllocation{ memoryRequirements.size, linear };
+
+    MemoryAllocation allocation{};
+    allocation.memory = targetBlock->memory;
+    allocation.offset = offset;
+    allocation.size = memoryRequirements.size;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    if (targetBlock->mappedData != nullptr)
+    {
+        allocation.mappedData = static_cast<uint8_t*>(targetBlock->mappedData) + offset;
+    }
+    return allocation;
+}
+
+void MemoryAllocator::Free(MemoryAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+        return;
+
+    auto& blockList = m_blocks[allocation.memoryTypeIndex];
+    auto it = std::find_if(blockList.begin(), blockList.end(),
+        [&](const std::unique_ptr<Block>& block) { return block->memory == allocation.memory; });
+    assert(it != blockList.end());
+
+    Block& block = **it;
+    block.allocations.erase(allocation.offset);
+
+    // Keep one empty shared block per memory type around so that resize bursts don't hit vkAllocateMemory again
+    if (block.allocations.empty())
+    {
+        bool release = block.dedicated || std::count_if(blockList.begin(), blockList.end(),
+            [](const std::unique_ptr<Block>& other) { return !other->dedicated && other->allocations.empty(); }) > 1;
+
+        if (release)
+        {
+            DestroyBlock(block);
+            blockList.erase(it);
+        }
+    }
+
+    allocation = MemoryAllocation{};
+}
+
+std::vector<MemoryAllocator::HeapStatistics> MemoryAllocator::GetHeapStatistics() const
+{
+    std::vector<HeapStatistics> stats(m_memoryProperties.memoryHeapCount);
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++)
+    {
+        stats[i].heapSize = m_memoryProperties.memoryHeaps[i].size;
+    }
+
+    for (uint32_t type = 0; type < m_blocks.size(); type++)
+    {
+        HeapStatistics& heapStats = stats[m_memoryProperties.memoryTypes[type].heapIndex];
+        for (auto& block : m_blocks[type])
+        {
+            heapStats.blockCount++;
+            heapStats.reservedBytes += block->size;
+            heapStats.allocationCount += (uint32_t)block->allocations.size();
+            for (auto& entry : block->allocations)
+            {
+                heapStats.usedBytes += entry.second.size;
+            }
+        }
+    }
+
+    return stats;
+}
+
+void MemoryAllocator::PrintStatistics() const
+{
+    constexpr double MiB = 1024.0 * 1024.0;
+
+    auto stats = GetHeapStatistics();
+    for (uint32_t i = 0; i < stats.size(); i++)
+    {
+        if (stats[i].blockCount == 0)
+            continue;
+
+        std::cout << "Heap " << i << " (" << stats[i].heapSize / MiB << " MiB) : "
+            << stats[i].blockCount << " block(s), "
+            << stats[i].allocationCount << " allocation(s), "
+            << stats[i].usedBytes / MiB << " / " << stats[i].reservedBytes / MiB << " MiB used" << std::endl;
+    }
+}
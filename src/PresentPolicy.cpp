@@ -0,0 +1,106 @@
+#include "PresentPolicy.h"
+#include <algorithm>
+#include <initializer_list>
+
+namespace
+{
+    // FIFO is the only mode every surface has to support, it is what's left when nothing preferred is available
+    VkPresentModeKHR PickPresentMode(std::initializer_list<VkPresentModeKHR> preferred, const std::vector<VkPresentModeKHR>& supportedModes)
+    {
+        for (VkPresentModeKHR mode : preferred)
+        {
+            if (std::find(supportedModes.begin(), supportedModes.end(), mode) != supportedModes.end())
+                return mode;
+        }
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+}
+
+PresentConfiguration ResolvePresentPolicy(const PresentPolicy& policy, const VkSurfaceCapabilitiesKHR& capabilities,
+    const std::vector<VkPresentModeKHR>& supportedModes)
+{
+    PresentConfiguration config{};
+    const uint32_t minImageCount = capabilities.minImageCount;
+
+    switch (policy.mode)
+    {
+    case PresentPolicy::Mode::LOW_LATENCY:
+        // Mailbox needs a third image to have something to replace, the others queue as little as possible
+        config.presentMode = PickPresentMode({ VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR }, supportedModes);
+        config.imageCount = config.presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3 : minImageCount;
+        config.framesInFlight = 1;
+        break;
+
+    case PresentPolicy::Mode::THROUGHPUT:
+        config.presentMode = PickPresentMode({ VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR }, supportedModes);
+        config.imageCount = minImageCount + 2;
+        config.framesInFlight = config.imageCount - 1;
+        break;
+
+    case PresentPolicy::Mode::POWER_SAVING:
+        // Paced by the display, anything queued beyond that only burns power earlier
+        config.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        config.imageCount = minImageCount;
+        config.framesInFlight = 1;
+        break;
+
+    case PresentPolicy::Mode::DEFAULT:
+    default:
+        config.presentMode = PickPresentMode({ VK_PRESENT_MODE_MAILBOX_KHR }, supportedModes);
+        config.imageCount = config.presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3 : minImageCount + 1;
+        config.framesInFlight = config.imageCount - 1;
+        break;
+    }
+
+    if (policy.imageCount > 0)
+        config.imageCount = policy.imageCount;
+    if (policy.framesInFlight > 0)
+        config.framesInFlight = policy.framesInFlight;
+
+    config.imageCount = std::max({ config.imageCount, minImageCount, 2u });
+    if (capabilities.maxImageCount > 0)
+        config.imageCount = std::min(config.imageCount, capabilities.maxImageCount);
+
+    // More frames in flight than images would only end up blocking in acquire
+    config.framesInFlight = std::clamp(config.framesInFlight, 1u, config.imageCount);
+
+    return config;
+}
+
+bool ParsePresentPolicyMode(const std::string& name, PresentPolicy::Mode& mode)
+{
+    if (name == "default")
+        mode = PresentPolicy::Mode::DEFAULT;
+    else if (name == "low-latency")
+        mode = PresentPolicy::Mode::LOW_LATENCY;
+    else if (name == "throughput")
+        mode = PresentPolicy::Mode::THROUGHPUT;
+    else if (name == "power-saving")
+        mode = PresentPolicy::Mode::POWER_SAVING;
+    else
+        return false;
+    return true;
+}
+
+const char* GetPresentPolicyModeName(PresentPolicy::Mode mode)
+{
+    switch (mode)
+    {
+    case PresentPolicy::Mode::LOW_LATENCY:  return "low-latency";
+    case PresentPolicy::Mode::THROUGHPUT:   return "throughput";
+    case PresentPolicy::Mode::POWER_SAVING: return "power-saving";
+    default:                                return "default";
+    }
+}
+
+const char* GetPresentModeName(VkPresentModeKHR presentMode)
+{
+    switch (presentMode)
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:    return "IMMEDIATE";
+    case VK_PRESENT_MODE_MAILBOX_KHR:      return "MAILBOX";
+    case VK_PRESENT_MODE_FIFO_KHR:         return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+    default:                               return "UNKNOWN";
+    }
+}
@@ -0,0 +1,189 @@
+#include "ReadbackRing.h"
+#include <algorithm>
+
+ReadbackRing::ReadbackRing(const VkDevice& device, const VkPhysicalDevice& physicalDevice, MemoryAllocator& allocator,
+    uint32_t framesInFlight, uint32_t width, uint32_t height) :
+    m_device(device), m_allocator(allocator), m_width(width), m_height(height), m_slots(framesInFlight)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkDeviceSize atomSize = properties.limits.nonCoherentAtomSize;
+
+    for (Slot& slot : m_slots)
+    {
+        VkBufferCreateInfo createInfo{};
+        createInfo.size = (VkDeviceSize)width * height * 4;
+        createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+
+        ErrorCheck(vkCreateBuffer(m_device, &createInfo, nullptr, &slot.buffer));
+
+        VkMemoryRequirements memReq{};
+        vkGetBufferMemoryRequirements(m_device, slot.buffer, &memReq);
+
+        // Same pick Allocate makes below, needed up front for the alignment
+        const VkMemoryPropertyFlags flags = m_allocator.GetMemoryType(
+            m_allocator.FindMemoryType(memReq.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT)).propertyFlags;
+        m_hostCached = (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) != 0;
+        m_coherent = (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+        // Invalidated ranges have to start and end on nonCoherentAtomSize, no neighbour may share an atom
+        if (!m_coherent)
+        {
+            memReq.alignment = std::max(memReq.alignment, atomSize);
+            memReq.size = (memReq.size + atomSize - 1) / atomSize * atomSize;
+        }
+
+        slot.memory = m_allocator.Allocate(memReq, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT, true);
+        ErrorCheck(vkBindBufferMemory(m_device, slot.buffer, slot.memory.memory, slot.memory.offset));
+    }
+}
+
+ReadbackRing::~ReadbackRing()
+{
+    for (Slot& slot : m_slots)
+    {
+        vkDestroyBuffer(m_device, slot.buffer, nullptr);
+        m_allocator.Free(slot.memory);
+    }
+}
+
+void ReadbackRing::RecordCopy(const VkCommandBuffer& commandBuffer, uint32_t frameInFlight, const VkImage& image,
+    VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask)
+{
+    // The host waited for the slot's previous frame before this one got recorded, its copy is complete
+    Slot& slot = m_slots[frameInFlight];
+    if (slot.state == SlotState::PENDING)
+        m_droppedFrames++;
+    slot.state = SlotState::RECORDED;
+
+    VkImageMemoryBarrier2 imageBarrier{};
+    imageBarrier.image = image;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.srcStageMask = srcStageMask;
+    imageBarrier.srcAccessMask = srcAccessMask;
+    imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.imageMemoryBarrierCount = 1;
+    dependencyInfo.pImageMemoryBarriers = &imageBarrier;
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { m_width, m_height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_GENERAL, slot.buffer, 1, &region);
+
+    // Makes the copy visible to host reads once the host saw the timeline value
+    VkBufferMemoryBarrier2 hostBarrier{};
+    hostBarrier.buffer = slot.buffer;
+    hostBarrier.size = VK_WHOLE_SIZE;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    hostBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    hostBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+
+    dependencyInfo.imageMemoryBarrierCount = 0;
+    dependencyInfo.pImageMemoryBarriers = nullptr;
+    dependencyInfo.bufferMemoryBarrierCount = 1;
+    dependencyInfo.pBufferMemoryBarriers = &hostBarrier;
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+void ReadbackRing::OnSubmitted(uint32_t frameInFlight, uint64_t frameIndex, const VkSemaphore& timelineSemaphore, uint64_t signalValue)
+{
+    Slot& slot = m_slots[frameInFlight];
+    assert(slot.state == SlotState::RECORDED);
+    slot.state = SlotState::PENDING;
+    slot.frameIndex = frameIndex;
+    slot.timelineSemaphore = timelineSemaphore;
+    slot.signalValue = signalValue;
+}
+
+bool ReadbackRing::FindCompleted(uint32_t& slotIndex)
+{
+    bool found = false;
+    for (uint32_t i = 0; i < (uint32_t)m_slots.size(); i++)
+    {
+        const Slot& slot = m_slots[i];
+        if (slot.state != SlotState::PENDING || (found && slot.frameIndex > m_slots[slotIndex].frameIndex))
+            continue;
+
+        // Just a query, never a wait
+        uint64_t value = 0;
+        ErrorCheck(vkGetSemaphoreCounterValue(m_device, slot.timelineSemaphore, &value));
+        if (value >= slot.signalValue)
+        {
+            slotIndex = i;
+            found = true;
+        }
+    }
+    return found;
+}
+
+ReadbackFrame ReadbackRing::Deliver(uint32_t slotIndex)
+{
+    Slot& slot = m_slots[slotIndex];
+    slot.state = SlotState::IDLE;
+
+    if (!m_coherent)
+    {
+        VkMappedMemoryRange range{};
+        range.memory = slot.memory.memory;
+        range.offset = slot.memory.offset;
+        range.size = slot.memory.size;
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        ErrorCheck(vkInvalidateMappedMemoryRanges(m_device, 1, &range));
+    }
+
+    ReadbackFrame frame{};
+    frame.frameIndex = slot.frameIndex;
+    frame.width = m_width;
+    frame.height = m_height;
+    frame.rowPitch = m_width * 4;
+    frame.pixels = (const uint8_t*)slot.memory.mappedData;
+    return frame;
+}
+
+bool ReadbackRing::Poll(ReadbackFrame& frame)
+{
+    uint32_t slot = 0;
+    if (!FindCompleted(slot))
+        return false;
+
+    frame = Deliver(slot);
+    return true;
+}
+
+uint32_t ReadbackRing::Poll(const std::function<void(const ReadbackFrame&)>& callback)
+{
+    uint32_t count = 0;
+    ReadbackFrame frame{};
+    while (Poll(frame))
+    {
+        callback(frame);
+        count++;
+    }
+    return count;
+}
+
+uint64_t ReadbackRing::GetDroppedFrameCount() const
+{
+    return m_droppedFrames;
+}
+
+bool ReadbackRing::IsHostCached() const
+{
+    return m_hostCached;
+}
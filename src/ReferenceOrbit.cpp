@@ -0,0 +1,109 @@
+#include "ReferenceOrbit.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Bits the reference orbit carries below the pixel step
+    constexpr int GUARD_BITS = 64;
+}
+
+ReferenceOrbitBuilder::ReferenceOrbitBuilder()
+{
+    m_worker = std::thread(&ReferenceOrbitBuilder::WorkerLoop, this);
+}
+
+ReferenceOrbitBuilder::~ReferenceOrbitBuilder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_condition.notify_all();
+    m_worker.join();
+}
+
+void ReferenceOrbitBuilder::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_condition.wait(lock, [this]() { return m_quit || m_hasRequest; });
+        if (m_quit)
+            return;
+
+        OrbitRequest request = m_request;
+        m_hasRequest = false;
+        m_busy = true;
+        lock.unlock();
+
+        auto orbit = std::make_shared<ReferenceOrbit>();
+        orbit->points = Compute(request.centerX, request.centerY, request.maxIterations);
+        orbit->centerX = request.centerX;
+        orbit->centerY = request.centerY;
+        orbit->maxIterations = request.maxIterations;
+
+        lock.lock();
+        orbit->version = m_nextVersion++;
+        m_latest = orbit;
+        m_busy = false;
+        m_condition.notify_all();
+    }
+}
+
+void ReferenceOrbitBuilder::Request(const BigFixed& centerX, const BigFixed& centerY, uint32_t maxIterations)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_lastRequest.maxIterations == maxIterations && m_lastRequest.centerX == centerX && m_lastRequest.centerY == centerY)
+            return;
+
+        m_lastRequest = { centerX, centerY, maxIterations };
+        m_request = m_lastRequest;
+        m_hasRequest = true;
+    }
+    m_condition.notify_all();
+}
+
+std::shared_ptr<const ReferenceOrbit> ReferenceOrbitBuilder::GetLatest() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_latest;
+}
+
+std::shared_ptr<const ReferenceOrbit> ReferenceOrbitBuilder::WaitForLatest()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return !m_hasRequest && !m_busy; });
+    return m_latest;
+}
+
+std::vector<float> ReferenceOrbitBuilder::Compute(const BigFixed& centerX, const BigFixed& centerY, uint32_t maxIterations)
+{
+    const uint32_t limbCount = centerX.GetLimbCount();
+    BigFixed zx(limbCount), zy(limbCount);
+
+    std::vector<float> points;
+    points.reserve(2 * ((size_t)maxIterations + 1));
+    for (uint32_t i = 0; i <= maxIterations; i++)
+    {
+        double x = zx.ToDouble(), y = zy.ToDouble();
+        points.push_back((float)x);
+        points.push_back((float)y);
+
+        // Past |Z| = 2 the orbit diverges, the kernel rebases the pixels still going onto Z(0)
+        if (x * x + y * y > 4.0)
+            break;
+
+        BigFixed zx2 = zx * zx;
+        BigFixed zy2 = zy * zy;
+        zy = (zx * zy).Twice() + centerY;
+        zx = zx2 - zy2 + centerX;
+    }
+    return points;
+}
+
+uint32_t ReferenceOrbitBuilder::GetLimbCount(double pixelStep)
+{
+    return 2 + (uint32_t)std::max(0, (-std::ilogb(pixelStep) + GUARD_BITS) / 32);
+}
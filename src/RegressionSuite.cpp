@@ -0,0 +1,419 @@
+#include "RegressionSuite.h"
+#include "VulkanManager.h"
+#include "FrameRing.h"
+#include "ReadbackRing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    // Small enough for a software ICD to get through every case in seconds
+    constexpr uint32_t IMAGE_SIZE = 512;
+    constexpr uint32_t WARMUP_FRAMES = 4;
+    constexpr uint32_t TIMED_FRAMES = 32;
+
+    // Timing differences below this are noise (host timer resolution, a single preempted frame), never a regression
+    constexpr double MIN_SLOWDOWN_MS = 0.05;
+
+    std::string GetGoldenPath(const std::string& directory, const std::string& name)
+    {
+        return directory + name + ".ppm";
+    }
+
+    // Binary PPM, RGB only: the storage image's alpha is always 1
+    bool WritePpm(const std::string& path, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgba)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        file << "P6\n" << width << " " << height << "\n255\n";
+        for (size_t i = 0; i < (size_t)width * height; i++)
+            file.write((const char*)&rgba[i * 4], 3);
+        return file.good();
+    }
+
+    // <case> <gpu ms> <host ms> <device name>, the name may contain spaces
+    bool ParseBaselineLine(const std::string& line, std::string& name, double& gpuMs, double& hostMs, std::string& deviceName)
+    {
+        std::istringstream stream(line);
+        return (stream >> name >> gpuMs >> hostMs) && std::getline(stream >> std::ws, deviceName);
+    }
+
+    bool ReadPpm(const std::string& path, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgb)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::string magic;
+        uint32_t maxValue = 0;
+        if (!(file >> magic >> width >> height >> maxValue) || magic != "P6" || maxValue != 255)
+            return false;
+
+        // Exactly one whitespace character separates the header from the pixels
+        file.get();
+        rgb.resize((size_t)width * height * 3);
+        file.read((char*)rgb.data(), rgb.size());
+        return file.gcount() == (std::streamsize)rgb.size();
+    }
+}
+
+RegressionSuite::RegressionSuite(VulkanManager& vulkanManager, const Options& options) :
+    m_vulkanManager(vulkanManager), m_options(options)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_vulkanManager.GetPhysicalDevice(), &properties);
+    m_deviceName = properties.deviceName;
+}
+
+std::vector<RegressionSuite::Case> RegressionSuite::GetCases()
+{
+    // 16x16 fits every device's limits. The views cover the three precisions, the cases the other kernel paths.
+    MandlebrotSettings base{};
+    base.workgroupSizeX = 16;
+    base.workgroupSizeY = 16;
+    base.maxIterations = 256;
+
+    MandlebrotView wholeSet{};
+    MandlebrotView seahorse{};
+    seahorse.centerX = -0.743643887037151;
+    seahorse.centerY = 0.131825904205330;
+    seahorse.zoom = 1e-6;
+    MandlebrotView deep{};
+    deep.preciseCenterX = "-0.743643887037158704752191506114774";
+    deep.preciseCenterY = "0.131825904205311970493132056385139";
+    deep.centerX = std::stod(deep.preciseCenterX);
+    deep.centerY = std::stod(deep.preciseCenterY);
+    deep.zoom = 1e-15;
+
+    std::vector<Case> cases;
+    cases.push_back({ "float", wholeSet, base });
+    cases.push_back({ "df64", seahorse, base });
+
+    MandlebrotSettings deepSettings = base;
+    deepSettings.maxIterations = 1024;
+    cases.push_back({ "perturbation", deep, deepSettings });
+
+    MandlebrotSettings culling = base;
+    culling.interiorCulling = true;
+    cases.push_back({ "interior-culling", wholeSet, culling });
+
+    MandlebrotSettings persistent = base;
+    persistent.kernel = MandlebrotKernel::PERSISTENT;
+    cases.push_back({ "persistent", wholeSet, persistent });
+
+    MandlebrotSettings marianiSilver = base;
+    marianiSilver.kernel = MandlebrotKernel::MARIANI_SILVER;
+    cases.push_back({ "mariani-silver", wholeSet, marianiSilver });
+
+    MandlebrotSettings hybrid = base;
+    hybrid.hybridCpu = true;
+    cases.push_back({ "hybrid", wholeSet, hybrid });
+    return cases;
+}
+
+RegressionSuite::CaseResult RegressionSuite::RunCase(const Case& testCase)
+{
+    const VkDevice& device = m_vulkanManager.GetLogicalDevice();
+    GpuProfiler& profiler = m_vulkanManager.GetGpuProfiler();
+    const uint32_t framesInFlight = m_vulkanManager.GetMaxFramesInFlight();
+
+    CaseResult result{};
+    result.name = testCase.name;
+
+    ComputeTask task(device, m_vulkanManager.GetMemoryAllocator(), m_vulkanManager.GetPipelineCache(),
+        profiler, m_vulkanManager.GetImmediateSubmitContext(), m_vulkanManager.GetComputeQueue(), m_vulkanManager.GetComputeQueueFamilyIndex(),
+        framesInFlight, IMAGE_SIZE, IMAGE_SIZE, testCase.settings);
+    m_vulkanManager.GetImmediateSubmitContext().SubmitAndWait();
+
+    FrameRing frameRing(device, framesInFlight, COMPUTE_FINISHED);
+    std::vector<TimelineSemaphore*> timelines(framesInFlight, nullptr);
+    // Last value each slot's timeline got asked to signal
+    std::vector<uint64_t> signaledValues(framesInFlight, 0);
+
+    auto RunFrames = [&](uint32_t count, bool timed)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            FrameRing::Frame frame = frameRing.BeginFrame();
+            timelines[frame.slot] = &frame.timeline;
+            if (frame.slotRetired)
+            {
+                profiler.Collect(frame.slot);
+
+                // BeginFrame returned, so the slot's previous frame has to be done
+                uint64_t value = 0;
+                ErrorCheck(vkGetSemaphoreCounterValue(device, frame.timeline.GetSemaphore(), &value));
+                result.timelineValid = result.timelineValid && value >= signaledValues[frame.slot];
+            }
+
+            // Timeline values only ever grow
+            const uint64_t signalValue = frame.timeline.GetTimelineValue(TimelineStages::COMPUTE_FINISHED);
+            result.timelineValid = result.timelineValid && signalValue > signaledValues[frame.slot];
+            signaledValues[frame.slot] = signalValue;
+
+            auto hostBegin = std::chrono::steady_clock::now();
+            task.Update((uint32_t)frame.index, frame.slot, frame.timeline.GetSemaphore(), signalValue, testCase.view);
+            if (timed)
+                result.hostMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - hostBegin).count();
+
+            frameRing.EndFrame();
+        }
+        frameRing.WaitIdle();
+        for (uint32_t i = 0; i < framesInFlight; i++)
+            profiler.Collect(i);
+    };
+
+    // Warmup covers pipeline creation on first use and the perturbation case's first reference orbit
+    RunFrames(WARMUP_FRAMES, false);
+    profiler.ResetStatistics();
+    RunFrames(TIMED_FRAMES, true);
+
+    result.hostMs /= TIMED_FRAMES;
+    GpuProfiler::ScopeSummary summary = profiler.GetSummary("Mandlebrot");
+    if (summary.count > 0)
+        result.gpuMs = summary.avgMs;
+
+    // One more frame with the readback copy, so it stays out of the timings
+    ReadbackRing readbackRing(device, m_vulkanManager.GetPhysicalDevice(), m_vulkanManager.GetMemoryAllocator(),
+        framesInFlight, IMAGE_SIZE, IMAGE_SIZE);
+    task.SetReadbackRing(&readbackRing);
+    RunFrames(1, false);
+    task.SetReadbackRing(nullptr);
+
+    // Everything retired: each slot sits exactly on its last frame's value. A missing signal leaves it below, a
+    // stray or out of order one (a later frame's value on the wrong slot) above.
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        if (timelines[i] == nullptr)
+            continue;
+        uint64_t value = 0;
+        ErrorCheck(vkGetSemaphoreCounterValue(device, timelines[i]->GetSemaphore(), &value));
+        result.timelineValid = result.timelineValid && value == signaledValues[i];
+    }
+
+    // RunFrames waited for the frame, an empty poll means the copy never got recorded or submitted
+    ReadbackFrame frame{};
+    if (!readbackRing.Poll(frame))
+    {
+        result.failure = "no frame read back";
+        return result;
+    }
+    std::vector<uint8_t> pixels(frame.pixels, frame.pixels + (size_t)frame.rowPitch * frame.height);
+    CompareWithReference(testCase, task.GetLastPrecision(), pixels, result);
+    return result;
+}
+
+bool RegressionSuite::GetReference(const Case& testCase, MandlebrotPrecision precision, std::vector<uint8_t>& rgb, std::string& source)
+{
+    uint32_t width = 0, height = 0;
+    if (ReadPpm(GetGoldenPath(m_options.goldenDirectory, testCase.name), width, height, rgb) && width == IMAGE_SIZE && height == IMAGE_SIZE)
+    {
+        source = "golden";
+        return true;
+    }
+
+    std::vector<uint32_t> rgba((size_t)IMAGE_SIZE * IMAGE_SIZE);
+    if (precision == MandlebrotPrecision::FLOAT)
+    {
+        m_cpuReference.Render(CpuMandlebrotParams::FromView(testCase.view, IMAGE_SIZE, IMAGE_SIZE, testCase.settings), rgba.data());
+    }
+    else if (!m_cpuReference.RenderPrecise(testCase.view, IMAGE_SIZE, IMAGE_SIZE, testCase.settings, rgba.data()))
+    {
+        return false;
+    }
+
+    // Red in the lowest byte, like the storage image's texels in memory
+    rgb.resize(rgba.size() * 3);
+    for (size_t i = 0; i < rgba.size(); i++)
+    {
+        for (size_t channel = 0; channel < 3; channel++)
+            rgb[i * 3 + channel] = (uint8_t)(rgba[i] >> (8 * channel));
+    }
+    source = "cpu";
+    return true;
+}
+
+void RegressionSuite::CompareWithReference(const Case& testCase, MandlebrotPrecision precision, const std::vector<uint8_t>& pixels,
+    CaseResult& result)
+{
+    if (m_options.updateGolden)
+    {
+        const std::string path = GetGoldenPath(m_options.goldenDirectory, testCase.name);
+        std::error_code error;
+        std::filesystem::create_directories(m_options.goldenDirectory, error);
+        if (!WritePpm(path, IMAGE_SIZE, IMAGE_SIZE, pixels))
+            std::cout << "Validate : could not write " << path << std::endl;
+    }
+
+    std::vector<uint8_t> reference;
+    if (!GetReference(testCase, precision, reference, result.reference))
+        return;
+
+    uint64_t mismatched = 0;
+    for (size_t i = 0; i < (size_t)IMAGE_SIZE * IMAGE_SIZE; i++)
+    {
+        uint32_t difference = 0;
+        for (size_t channel = 0; channel < 3; channel++)
+            difference = std::max<uint32_t>(difference, std::abs(pixels[i * 4 + channel] - reference[i * 3 + channel]));
+
+        result.maxChannelDifference = std::max(result.maxChannelDifference, difference);
+        if (difference > m_options.channelTolerance)
+            mismatched++;
+    }
+    result.mismatchedPixelFraction = (double)mismatched / ((double)IMAGE_SIZE * IMAGE_SIZE);
+}
+
+std::string RegressionSuite::GetBaselinePath() const
+{
+    return m_options.baselinePath.empty() ? m_options.goldenDirectory + "baseline.txt" : m_options.baselinePath;
+}
+
+void RegressionSuite::LoadBaseline(std::vector<CaseResult>& results) const
+{
+    std::ifstream file(GetBaselinePath());
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::string name, deviceName;
+        double gpuMs = 0.0, hostMs = 0.0;
+        if (!ParseBaselineLine(line, name, gpuMs, hostMs, deviceName) || deviceName != m_deviceName)
+            continue;
+
+        for (CaseResult& result : results)
+        {
+            if (result.name == name)
+            {
+                result.baselineFound = true;
+                result.baselineGpuMs = gpuMs;
+                result.baselineHostMs = hostMs;
+            }
+        }
+    }
+}
+
+void RegressionSuite::SaveBaseline() const
+{
+    const std::string path = GetBaselinePath();
+
+    // Keep the other devices' lines, and lines that don't parse
+    auto IsOtherDevice = [this](const std::string& line)
+    {
+        std::string name, deviceName;
+        double gpuMs = 0.0, hostMs = 0.0;
+        return !ParseBaselineLine(line, name, gpuMs, hostMs, deviceName) || deviceName != m_deviceName;
+    };
+
+    std::vector<std::string> lines;
+    for (const CaseResult& result : m_results)
+    {
+        const bool record = m_options.updateBaseline || !result.baselineFound;
+        std::ostringstream line;
+        line << result.name << " " << (record ? result.gpuMs : result.baselineGpuMs) << " "
+            << (record ? result.hostMs : result.baselineHostMs) << " " << m_deviceName;
+        lines.push_back(line.str());
+    }
+
+    if (!RewriteLines(path, IsOtherDevice, lines))
+        std::cout << "Validate : could not write " << path << std::endl;
+}
+
+bool RegressionSuite::Run()
+{
+    m_results.clear();
+    for (const Case& testCase : GetCases())
+        m_results.push_back(RunCase(testCase));
+
+    // Cases without a line are only recorded this run, the next one compares against them
+    LoadBaseline(m_results);
+    const bool recordBaseline = std::any_of(m_results.begin(), m_results.end(), [](const CaseResult& result) { return !result.baselineFound; });
+    if (m_options.updateBaseline || recordBaseline)
+    {
+        SaveBaseline();
+        std::cout << "Validate : " << (m_options.updateBaseline ? "updated" : "recorded missing") << " baseline times in "
+            << GetBaselinePath() << std::endl;
+    }
+    if (m_options.updateBaseline)
+    {
+        for (CaseResult& result : m_results)
+        {
+            result.baselineGpuMs = result.gpuMs;
+            result.baselineHostMs = result.hostMs;
+        }
+    }
+
+    auto IsSlower = [this](double ms, double baselineMs)
+    {
+        return ms >= 0.0 && baselineMs >= 0.0 && ms > baselineMs * m_options.maxSlowdown && ms - baselineMs > MIN_SLOWDOWN_MS;
+    };
+
+    // First failed check, empty when all passed
+    auto GetFailure = [&](const CaseResult& result) -> std::string
+    {
+        if (!result.timelineValid)
+            return "timeline values out of order";
+        if (result.reference.empty())
+            return "no reference image, neither a golden nor a CPU rendering (run with --update-golden)";
+        if (result.mismatchedPixelFraction > m_options.pixelTolerance)
+            return "image differs from the " + result.reference + " reference";
+        if (IsSlower(result.gpuMs, result.baselineGpuMs))
+            return "GPU time regressed";
+        if (IsSlower(result.hostMs, result.baselineHostMs))
+            return "host time regressed";
+        return "";
+    };
+
+    bool passed = true;
+    for (CaseResult& result : m_results)
+    {
+        // RunCase fails a case without a read back frame itself
+        if (result.failure.empty())
+            result.failure = GetFailure(result);
+        result.passed = result.failure.empty();
+        passed = passed && result.passed;
+
+        std::cout << "Validate : " << result.name << " " << (result.passed ? "passed" : "FAILED, " + result.failure)
+            << " (" << result.mismatchedPixelFraction * 100.0 << "% pixels differ from the " << result.reference << " reference, gpu "
+            << result.gpuMs << " ms, host " << result.hostMs << " ms)" << std::endl;
+    }
+    return passed;
+}
+
+std::string RegressionSuite::GetReport() const
+{
+    bool passed = true;
+    std::ostringstream json;
+    json << "{\n"
+        << "  \"device\": \"" << m_deviceName << "\",\n"
+        << "  \"width\": " << IMAGE_SIZE << ",\n"
+        << "  \"height\": " << IMAGE_SIZE << ",\n"
+        << "  \"channel_tolerance\": " << m_options.channelTolerance << ",\n"
+        << "  \"pixel_tolerance\": " << m_options.pixelTolerance << ",\n"
+        << "  \"max_slowdown\": " << m_options.maxSlowdown << ",\n"
+        << "  \"cases\": [";
+    for (size_t i = 0; i < m_results.size(); i++)
+    {
+        const CaseResult& result = m_results[i];
+        passed = passed && result.passed;
+        json << (i > 0 ? "," : "") << "\n    {"
+            << " \"name\": \"" << result.name << "\","
+            << " \"passed\": " << (result.passed ? "true" : "false") << ","
+            << " \"failure\": \"" << result.failure << "\","
+            << " \"reference\": \"" << result.reference << "\","
+            << " \"timeline_valid\": " << (result.timelineValid ? "true" : "false") << ","
+            << " \"mismatched_pixel_fraction\": " << result.mismatchedPixelFraction << ","
+            << " \"max_channel_difference\": " << result.maxChannelDifference << ","
+            << " \"gpu_ms_per_frame\": " << result.gpuMs << ","
+            << " \"host_ms_per_frame\": " << result.hostMs << ","
+            << " \"baseline_recorded\": " << (result.baselineFound ? "false" : "true") << ","
+            << " \"baseline_gpu_ms_per_frame\": " << result.baselineGpuMs << ","
+            << " \"baseline_host_ms_per_frame\": " << result.baselineHostMs << " }";
+    }
+    json << "\n  ],\n"
+        << "  \"passed\": " << (passed ? "true" : "false") << "\n"
+        << "}\n";
+    return json.str();
+}
@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <optional>
 #include <fstream>
+#include <cstring>
+#include <filesystem>
 
 void ErrorCheck(VkResult result)
 {
@@ -87,45 +89,13 @@ void FreeCommandBuffer(const VkDevice & device, const VkCommandPool & commandPoo
     vkFreeCommandBuffers(device, commandPool, 1, commandBuffer);
 }
 
-VkDeviceMemory AllocateHostCoherentMemory(const VkPhysicalDevice & physicalDevice, const VkDevice & device, const VkDeviceSize & bufferSize, const VkMemoryRequirements & memoryRequirements)
+MemoryAllocation AllocateHostCoherentMemory(MemoryAllocator& allocator, const VkDeviceSize & bufferSize, const VkMemoryRequirements & memoryRequirements)
 {
-    // Get memory types supported by the physical device:
-    VkPhysicalDeviceMemoryProperties memoryProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    VkMemoryRequirements requirements = memoryRequirements;
+    requirements.size = std::max(bufferSize, memoryRequirements.size);
 
-    std::optional<uint32_t> memIndex;
-    // In search for a suitable memory type INDEX:
-    for (uint32_t i = 0u; i < memoryProperties.memoryTypeCount; ++i)
-    {
-        // Is this kind of memory suitable for our buffer?
-        const auto bitmask = memoryRequirements.memoryTypeBits;
-        const auto bit = 1 << i;
-        if (0 == (bitmask & bit)) 
-        {
-            continue; // => nope
-        }
-
-        // Does this kind of memory support our usage requirements?
-        if ((memoryProperties.memoryTypes[i].propertyFlags & (VkMemoryPropertyFlagBits::VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VkMemoryPropertyFlagBits::VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-            != VkMemoryPropertyFlags{})
-        {
-            // Return the INDEX of a suitable memory type
-            memIndex = i;
-            break;
-        }
-    }
-
-    assert(memIndex.has_value() == true);
-
-    VkMemoryAllocateInfo memoryAllocInfo = {};
-    memoryAllocInfo.allocationSize = std::max(bufferSize, memoryRequirements.size);
-    memoryAllocInfo.memoryTypeIndex = memIndex.value();
-    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-
-    VkDeviceMemory memory = VK_NULL_HANDLE;
-    ErrorCheck(vkAllocateMemory(device, &memoryAllocInfo, nullptr, &memory));
-
-    return memory;
+    return allocator.Allocate(requirements,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, true);
 }
 
 //std::tuple<VkBuffer, VkDeviceMemory, int, int> LoadImageIntoHostCoherentMemory(const VkPhysicalDevice & physicalDevice, const VkDevice & device, const std::string & pathToImageFile)
@@ -138,6 +108,11 @@ void FreeMemory(const VkDevice & device, const VkDeviceMemory& memory)
     vkFreeMemory(device, memory, nullptr);
 }
 
+void FreeMemory(MemoryAllocator& allocator, MemoryAllocation& allocation)
+{
+    allocator.Free(allocation);
+}
+
 void DestroyBuffer(const VkDevice & device, const VkBuffer& buffer)
 {
     vkDestroyBuffer(device, buffer, nullptr);
@@ -169,7 +144,7 @@ void CopyBufferToImage(const VkCommandBuffer & commandBuffer, const VkBuffer & b
     vkCmdCopyBufferToImage(commandBuffer, buffer, image, VkImageLayout::VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufImagCopy);
 }
 
-std::tuple<VkImage, VkDeviceMemory> CreateImage(const VkDevice & device, const VkPhysicalDevice & physicalDevice, const uint32_t width, const uint32_t height, const VkFormat & format, const VkImageUsageFlags & usageFlags)
+std::tuple<VkImage, MemoryAllocation> CreateImage(const VkDevice & device, MemoryAllocator& allocator, const uint32_t width, const uint32_t height, const VkFormat & format, const VkImageUsageFlags & usageFlags)
 {
     VkImage image = VK_NULL_HANDLE;
     VkImageCreateInfo createInfo = {};
@@ -189,41 +164,9 @@ std::tuple<VkImage, VkDeviceMemory> CreateImage(const VkDevice & device, const V
     VkMemoryRequirements memReq{};
     vkGetImageMemoryRequirements(device, image, &memReq);
 
-    VkMemoryAllocateInfo memoryAllocInfo = {};
-    memoryAllocInfo.allocationSize = memReq.size;
-    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memoryAllocInfo.memoryTypeIndex = ([&]()
-    {
-        // Get memory types supported by the physical device:
-        VkPhysicalDeviceMemoryProperties memoryProperties{};
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
-
-        // In search for a suitable memory type INDEX:
-        for (uint32_t i = 0u; i < memoryProperties.memoryTypeCount; ++i)
-        {
-
-            // Is this kind of memory suitable for our buffer?
-            const auto bitmask = memReq.memoryTypeBits;
-            const auto bit = 1 << i;
-            if (0 == (bitmask & bit))
-            {
-                continue; // => nope
-            }
-
-            // Does this kind of memory support our usage requirements?
-            if ((memoryProperties.memoryTypes[i].propertyFlags & VkMemoryPropertyFlagBits::VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) // In contrast to our host-coherent buffers, we just assume that we want all our images to live in device memory
-                != VkMemoryPropertyFlags{})
-            {
-                // Return the INDEX of a suitable memory type
-                return i;
-            }
-        }
-        throw std::runtime_error("Couldn't find suitable memory.");
-    }());
-
-    VkDeviceMemory memory;
-    ErrorCheck(vkAllocateMemory(device, &memoryAllocInfo, nullptr, &memory));
-    ErrorCheck(vkBindImageMemory(device, image, memory, 0));
+    // In contrast to our host-coherent buffers, we just assume that we want all our images to live in device memory
+    MemoryAllocation memory = allocator.Allocate(memReq, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, false);
+    ErrorCheck(vkBindImageMemory(device, image, memory.memory, memory.offset));
 
     return std::make_tuple(image, memory);
 }
@@ -261,16 +204,21 @@ std::tuple<VkShaderModule, VkPipelineShaderStageCreateInfo> CreateShaderModule(c
     }
 
     size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
+    std::vector<uint32_t> buffer((fileSize + sizeof(uint32_t) - 1) / sizeof(uint32_t));
 
     file.seekg(0);
-    file.read(buffer.data(), fileSize);
+    file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
 
     file.close();
 
+    return CreateShaderModule(device, buffer.data(), fileSize, shaderStage);
+}
+
+std::tuple<VkShaderModule, VkPipelineShaderStageCreateInfo> CreateShaderModule(const VkDevice & device, const uint32_t * code, const size_t codeSizeInBytes, const VkShaderStageFlagBits & shaderStage)
+{
     VkShaderModuleCreateInfo moduleCreateInfo{};
-    moduleCreateInfo.codeSize = buffer.size();
-    moduleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(buffer.data());
+    moduleCreateInfo.codeSize = codeSizeInBytes;
+    moduleCreateInfo.pCode = code;
     moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 
     VkShaderModule shaderModule = VK_NULL_HANDLE;
@@ -290,44 +238,43 @@ void DestroyShaderModule(const VkDevice & device, VkShaderModule shaderModule)
     vkDestroyShaderModule(device, shaderModule, nullptr);
 }
 
-std::tuple<VkBuffer, VkDeviceMemory> CreateBufferAndMemory(const VkDevice & device, const VkPhysicalDevice & physicalDevice, const size_t bufferSize, const VkBufferUsageFlags & bufferUsageFlags)
+std::tuple<VkBuffer, MemoryAllocation> CreateBufferAndMemory(const VkDevice & device, MemoryAllocator& allocator, const size_t bufferSize, const VkBufferUsageFlags & bufferUsageFlags, const VkMemoryPropertyFlags& memoryPropertyFlags)
 {
-    return std::tuple<VkBuffer, VkDeviceMemory>();
-}
+    VkBufferCreateInfo createInfo = {};
+    createInfo.size = bufferSize;
+    createInfo.usage = bufferUsageFlags;
+    createInfo.sharingMode = VkSharingMode::VK_SHARING_MODE_EXCLUSIVE;
+    createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 
-void CopyDataIntoHostCoherentMemory(const VkDevice & device, const size_t & dataSize, const void * data, VkDeviceMemory & memory)
-{
-}
+    VkBuffer buffer = VK_NULL_HANDLE;
+    ErrorCheck(vkCreateBuffer(device, &createInfo, nullptr, &buffer));
 
-void ChangeImageLayout(const VkDevice& device, std::vector<VkImage>& imageList, const VkQueue& queue,
-    uint32_t queueFamilyIndex, VkImageLayout oldLayout, VkImageLayout newLayout)
-{
-    VkCommandPool pool = VK_NULL_HANDLE;
-    VkCommandPoolCreateInfo info{};
-    info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-    info.pNext = nullptr;
-    info.queueFamilyIndex = queueFamilyIndex;
-    info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    VkMemoryRequirements memReq{};
+    vkGetBufferMemoryRequirements(device, buffer, &memReq);
 
-    ErrorCheck(vkCreateCommandPool(device, &info, nullptr, &pool));
+    MemoryAllocation memory = allocator.Allocate(memReq, memoryPropertyFlags, 0, true);
+    ErrorCheck(vkBindBufferMemory(device, buffer, memory.memory, memory.offset));
 
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.commandBufferCount = 1;
-    allocInfo.commandPool = pool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.pNext = nullptr;
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    return std::make_tuple(buffer, memory);
+}
 
-    VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
-    ErrorCheck(vkAllocateCommandBuffers(device, &allocInfo, &cmdBuffer));
+void CopyDataIntoHostCoherentMemory(const size_t & dataSize, const void * data, const MemoryAllocation & memory)
+{
+    assert(memory.mappedData != nullptr);
+    assert(dataSize <= memory.size);
+    memcpy(memory.mappedData, data, dataSize);
+}
 
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    beginInfo.pInheritanceInfo = nullptr;
-    beginInfo.pNext = nullptr;
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+void CopyDataFromHostCoherentMemory(const size_t & dataSize, void * data, const MemoryAllocation & memory)
+{
+    assert(memory.mappedData != nullptr);
+    assert(dataSize <= memory.size);
+    memcpy(data, memory.mappedData, dataSize);
+}
 
-    vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+void ChangeImageLayout(const VkCommandBuffer& commandBuffer, const std::vector<VkImage>& imageList,
+    VkImageLayout oldLayout, VkImageLayout newLayout)
+{
     std::vector<VkImageMemoryBarrier2> list;
     for (auto& image : imageList)
     {
@@ -358,24 +305,43 @@ void ChangeImageLayout(const VkDevice& device, std::vector<VkImage>& imageList,
     dependencyInfo.pNext = nullptr;
     dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
 
-    vkCmdPipelineBarrier2(cmdBuffer, &dependencyInfo);
-    vkEndCommandBuffer(cmdBuffer);
+    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
 
-    VkFence fence = VK_NULL_HANDLE;
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.pNext = nullptr;
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    ErrorCheck(vkCreateFence(device, &fenceInfo, nullptr, &fence));
+bool RewriteLines(const std::string& path, const std::function<bool(const std::string& line)>& keepLine,
+    const std::vector<std::string>& newLines)
+{
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (keepLine(line))
+                lines.push_back(line);
+        }
+    }
+    lines.insert(lines.end(), newLines.begin(), newLines.end());
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cmdBuffer;
-    submitInfo.pNext = nullptr;
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    ErrorCheck(vkQueueSubmit(queue, 1, &submitInfo, fence));
+    const std::string tempPath = path + ".tmp";
+    std::error_code errorCode;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), errorCode);
 
-    ErrorCheck(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX));
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open())
+            return false;
+        for (const auto& line : lines)
+            file << line << "\n";
+        if (!file.good())
+            return false;
+    }
 
-    vkDestroyFence(device, fence, nullptr);
-    vkDestroyCommandPool(device, pool, nullptr);
-}
\ No newline at end of file
+    std::filesystem::rename(tempPath, path, errorCode);
+    if (errorCode)
+    {
+        std::filesystem::remove(tempPath, errorCode);
+        return false;
+    }
+    return true;
+}
@@ -1,5 +1,6 @@
 #include "ValidationManager.h"
 #include <assert.h>
+#include <cstring>
 
 namespace
 {
@@ -185,7 +186,7 @@ void ValidationManager::AddRequiredPlatformInstanceExtensions(std::vector<const
 #endif
 }
 
-ValidationManager::ValidationManager()
+ValidationManager::ValidationManager(bool headless) : m_headless(headless)
 {
     SetupLayersAndExtensions();
     SetupDebug();
@@ -271,12 +272,17 @@ void ValidationManager::DeinitDebug()
 
 void ValidationManager::SetupLayersAndExtensions()
 {
-    instanceExtensionNameList.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
     instanceExtensionNameList.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
-    deviceExtensionNameList.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     deviceExtensionNameList.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
     deviceExtensionNameList.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
 
+    // Headless runs have no window system, so neither the surface nor the swapchain extensions are required
+    if (m_headless)
+        return;
+
+    instanceExtensionNameList.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+    deviceExtensionNameList.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
     AddRequiredPlatformInstanceExtensions(&instanceExtensionNameList);
 }
 
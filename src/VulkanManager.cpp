@@ -1,110 +1,67 @@
-#include "..\inc\VulkanManager.h"
+#include "VulkanManager.h"
 #include <vector>
 #include <array>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <algorithm>
 #include "Utils.h"
+#include "FrameStats.h"
 
 namespace
 {
-    std::vector<VkDeviceQueueCreateInfo> FindQueue(const uint32_t & queueFamilyIndex)
+    // Written in front of the vkGetPipelineCacheData blob. The driver validates its own header too, but checking
+    // the driver version lets us drop stale data after a driver update without relying on that.
+    struct PipelineCacheFileHeader
     {
-        constexpr uint32_t minGraphicQueueRequired = 1, minCopmuteQueueRequired = 1;
-
-        float queuePriority[minGraphicQueueRequired + minCopmuteQueueRequired]{ 1.0f, 1.0f};
-
-        std::vector<VkDeviceQueueCreateInfo> creatInfoList;
-
-        VkDeviceQueueCreateInfo info = {};
-        info.flags = 0;
-        info.pNext = nullptr;
-        info.pQueuePriorities = queuePriority;
-        info.queueCount = minGraphicQueueRequired + minCopmuteQueueRequired;
-        info.queueFamilyIndex = queueFamilyIndex;
-        info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        uint32_t magic;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+    };
 
-        creatInfoList.push_back(info);
+    constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x50434B56; // "VKCP"
+    constexpr uint64_t PIPELINE_CACHE_MAX_SIZE = 256ull << 20; // far above any real cache, guards the allocation
 
-        return creatInfoList;
+    std::string GetPipelineCacheFilePath()
+    {
+        return std::string(CACHE_PATH) + "pipeline.cache";
     }
 
-    void MakeSwapchainImagesPresentable(const VkDevice& device, std::vector<VkImage>& imageList, const VkQueue& queue, uint32_t queueFamilyIndex)
+    // One create info per family in use, with as many queues as the roles placed in it
+    std::vector<VkDeviceQueueCreateInfo> FindQueue(const QueueFamilySelection& selection)
     {
-        VkCommandPool pool = VK_NULL_HANDLE;
-        VkCommandPoolCreateInfo info{};
-        info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-        info.pNext = nullptr;
-        info.queueFamilyIndex = queueFamilyIndex;
-        info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-
-        ErrorCheck(vkCreateCommandPool(device, &info, nullptr, &pool));
-
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.commandBufferCount = 1;
-        allocInfo.commandPool = pool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.pNext = nullptr;
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-
-        VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
-        ErrorCheck(vkAllocateCommandBuffers(device, &allocInfo, &cmdBuffer));
+        static const float queuePriority[3]{ 1.0f, 1.0f, 1.0f };
 
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        beginInfo.pInheritanceInfo = nullptr;
-        beginInfo.pNext = nullptr;
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-        vkBeginCommandBuffer(cmdBuffer, &beginInfo);
-        std::vector<VkImageMemoryBarrier2> list;
-        for (auto& image : imageList)
+        std::vector<VkDeviceQueueCreateInfo> creatInfoList;
+        for (const QueueLocation& location : { selection.graphics, selection.compute, selection.transfer })
         {
-            VkImageMemoryBarrier2 imgBarrier{};
-            imgBarrier.dstAccessMask = 0;
-            imgBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            imgBarrier.dstStageMask = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT;
-            imgBarrier.image = image;
-            imgBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-            imgBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            imgBarrier.pNext = nullptr;
-            imgBarrier.srcAccessMask = 0;
-            imgBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            imgBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT;
-            imgBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
-            imgBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            imgBarrier.subresourceRange.baseArrayLayer = 0;
-            imgBarrier.subresourceRange.baseMipLevel = 0;
-            imgBarrier.subresourceRange.layerCount = 1;
-            imgBarrier.subresourceRange.levelCount = 1;
-            list.push_back(imgBarrier);
-        }
-
-        VkDependencyInfo dependencyInfo{};
-        dependencyInfo.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-        dependencyInfo.imageMemoryBarrierCount = list.size();
-        dependencyInfo.pImageMemoryBarriers = list.data();
-        dependencyInfo.pNext = nullptr;
-        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-
-        vkCmdPipelineBarrier2(cmdBuffer, &dependencyInfo);
-        vkEndCommandBuffer(cmdBuffer);
+            auto it = std::find_if(creatInfoList.begin(), creatInfoList.end(),
+                [&](const VkDeviceQueueCreateInfo& info) { return info.queueFamilyIndex == location.familyIndex; });
 
-        VkFence fence = VK_NULL_HANDLE;
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.pNext = nullptr;
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        ErrorCheck(vkCreateFence(device, &fenceInfo, nullptr, &fence));
-
-        VkSubmitInfo submitInfo{};
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &cmdBuffer;
-        submitInfo.pNext = nullptr;
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        ErrorCheck(vkQueueSubmit(queue, 1, &submitInfo, fence));
-
-        ErrorCheck(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX));
+            if (it == creatInfoList.end())
+            {
+                VkDeviceQueueCreateInfo info = {};
+                info.flags = 0;
+                info.pNext = nullptr;
+                info.pQueuePriorities = queuePriority;
+                info.queueCount = location.queueIndex + 1;
+                info.queueFamilyIndex = location.familyIndex;
+                info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+
+                creatInfoList.push_back(info);
+            }
+            else
+            {
+                it->queueCount = std::max(it->queueCount, location.queueIndex + 1);
+            }
+        }
 
-        vkDestroyFence(device, fence, nullptr);
-        vkDestroyCommandPool(device, pool, nullptr);
+        return creatInfoList;
     }
+
 }
 
 void VulkanManager::CreateInstance()
@@ -129,11 +86,17 @@ void VulkanManager::CreateInstance()
     ErrorCheck(vkCreateInstance(&createInfoObj, nullptr, &m_instanceObj));
 }
 
-void VulkanManager::CreateLogicalDevice(const uint32_t & queueFamilyIndex)
+void VulkanManager::CreateLogicalDevice()
 {
+    // Lets the GpuProfiler recycle its timestamp queries from the host
+    VkPhysicalDeviceHostQueryResetFeatures hostQueryResetFeatures{};
+    hostQueryResetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES;
+    hostQueryResetFeatures.hostQueryReset = VK_TRUE;
+
     VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
     timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
     timelineFeatures.timelineSemaphore = VK_TRUE;
+    timelineFeatures.pNext = &hostQueryResetFeatures;
 
     VkPhysicalDeviceDynamicRenderingFeatures dynamic_rendering_feature{};
     dynamic_rendering_feature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
@@ -149,7 +112,7 @@ void VulkanManager::CreateLogicalDevice(const uint32_t & queueFamilyIndex)
     physicalFeatures2.pNext = &sync2;
     vkGetPhysicalDeviceFeatures2(m_physicalDevice, &physicalFeatures2);
 
-    std::vector<VkDeviceQueueCreateInfo> deviceQueueCreateInfoList = FindQueue(queueFamilyIndex);
+    std::vector<VkDeviceQueueCreateInfo> deviceQueueCreateInfoList = FindQueue(m_queueFamilies);
 
     VkDeviceCreateInfo vkDeviceCreateInfoObj{};
     vkDeviceCreateInfoObj.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -162,6 +125,9 @@ void VulkanManager::CreateLogicalDevice(const uint32_t & queueFamilyIndex)
     vkDeviceCreateInfoObj.pNext = &physicalFeatures2;
 
     ErrorCheck(vkCreateDevice(m_physicalDevice, &vkDeviceCreateInfoObj, nullptr, &m_logicalDevice));
+
+    // Every supported feature is enabled above, this one decides whether swapchain images can be compute targets
+    m_storageWriteWithoutFormat = physicalFeatures2.features.shaderStorageImageWriteWithoutFormat == VK_TRUE;
 }
 
 void VulkanManager::AcquirePhysicalDevice()
@@ -173,6 +139,7 @@ void VulkanManager::AcquirePhysicalDevice()
 
     VkPhysicalDevice discreteGpu = VK_NULL_HANDLE;
     VkPhysicalDevice integratedGpu = VK_NULL_HANDLE;
+    VkPhysicalDevice otherDevice = VK_NULL_HANDLE;
     for (auto dev : deviceList)
     {
         VkPhysicalDeviceProperties deviceProp = {};
@@ -188,6 +155,11 @@ void VulkanManager::AcquirePhysicalDevice()
         {
             integratedGpu = dev;
         }
+        else if (otherDevice == VK_NULL_HANDLE)
+        {
+            // Software ICDs (lavapipe, swiftshader) report CPU / virtual device types
+            otherDevice = dev;
+        }
     }
 
     if (discreteGpu != VK_NULL_HANDLE)
@@ -198,6 +170,10 @@ void VulkanManager::AcquirePhysicalDevice()
     {
         m_physicalDevice = integratedGpu;
     }
+    else if (otherDevice != VK_NULL_HANDLE)
+    {
+        m_physicalDevice = otherDevice;
+    }
 
     if (m_physicalDevice == VK_NULL_HANDLE)
     {
@@ -206,13 +182,11 @@ void VulkanManager::AcquirePhysicalDevice()
     }
 }
 
-uint32_t VulkanManager::GetQueuesFamilyIndex()
+QueueFamilySelection VulkanManager::GetQueueFamilies()
 {
-    uint32_t graphicsReq = VK_QUEUE_GRAPHICS_BIT;
-    uint32_t computeReq = VK_QUEUE_COMPUTE_BIT;
-    uint32_t transferReq = VK_QUEUE_TRANSFER_BIT;
-
-    uint32_t graphicsQueueFamilyIndex, computeQueueFamilyIndex;
+    const uint32_t graphicsReq = VK_QUEUE_GRAPHICS_BIT;
+    const uint32_t computeReq = VK_QUEUE_COMPUTE_BIT;
+    const uint32_t transferReq = VK_QUEUE_TRANSFER_BIT;
 
     uint32_t qFamilyCount = 0;
     std::vector<VkQueueFamilyProperties> propertyList;
@@ -220,32 +194,72 @@ uint32_t VulkanManager::GetQueuesFamilyIndex()
     propertyList.resize(qFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &qFamilyCount, propertyList.data());
 
-    uint16_t count = 0;
-    bool sameFamily = false;
-    for (uint32_t j = 0; j < qFamilyCount; j++)
+    auto HasFlags = [&](uint32_t family, uint32_t req)
     {
-        count = 0;
+        return (propertyList[family].queueFlags & req) == req;
+    };
 
-        if (propertyList[j].queueFlags & graphicsReq == graphicsReq)
-        {
-            graphicsQueueFamilyIndex = j;
-            count++;
-        }
+    // Hands out the next unused queue of the family, or shares its last one when they ran out
+    std::vector<uint32_t> queuesUsed(qFamilyCount, 0);
+    auto TakeQueue = [&](uint32_t family)
+    {
+        QueueLocation location{ family, std::min(queuesUsed[family], propertyList[family].queueCount - 1) };
+        queuesUsed[family] = location.queueIndex + 1;
+        return location;
+    };
 
-        if (propertyList[j].queueFlags & computeReq == computeReq)
+    // Graphics also presents, the swapchain images are owned by it
+    uint32_t graphicsFamily = UINT32_MAX;
+    for (uint32_t j = 0; j < qFamilyCount && graphicsFamily == UINT32_MAX; j++)
+    {
+        if (!HasFlags(j, graphicsReq | computeReq))
+            continue;
+
+        VkBool32 presentSupported = VK_TRUE;
+        if (!m_headless)
+            ErrorCheck(vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevice, j, m_surface, &presentSupported));
+        if (presentSupported)
+            graphicsFamily = j;
+    }
+    if (graphicsFamily == UINT32_MAX)
+    {
+        assert(0);
+        std::exit(-1);
+    }
+
+    // Async compute: a family without graphics runs on its own hardware queue, next best is a second queue
+    // of the graphics family
+    uint32_t computeFamily = graphicsFamily;
+    for (uint32_t j = 0; j < qFamilyCount; j++)
+    {
+        if (HasFlags(j, computeReq) && !HasFlags(j, graphicsReq))
         {
-            computeQueueFamilyIndex = j;
-            count++;
+            computeFamily = j;
+            break;
         }
-        if (count == 2)
+    }
+
+    // DMA: a transfer only family, otherwise whatever is left next to compute
+    uint32_t transferFamily = computeFamily;
+    for (uint32_t j = 0; j < qFamilyCount; j++)
+    {
+        if (HasFlags(j, transferReq) && !HasFlags(j, graphicsReq) && !HasFlags(j, computeReq))
         {
-            sameFamily = true;
+            transferFamily = j;
             break;
         }
     }
 
-    assert(sameFamily == true);
-    return graphicsQueueFamilyIndex;
+    QueueFamilySelection selection{};
+    selection.graphics = TakeQueue(graphicsFamily);
+    selection.compute = TakeQueue(computeFamily);
+    selection.transfer = TakeQueue(transferFamily);
+
+    std::cout << "Queues : graphics " << selection.graphics.familyIndex << "." << selection.graphics.queueIndex
+        << ", compute " << selection.compute.familyIndex << "." << selection.compute.queueIndex
+        << ", transfer " << selection.transfer.familyIndex << "." << selection.transfer.queueIndex << " (family.queue)" << std::endl;
+
+    return selection;
 }
 
 void VulkanManager::GetMaxUsableVKSampleCount()
@@ -279,9 +293,11 @@ VulkanManager::~VulkanManager()
 {
 }
 
-VulkanManager::VulkanManager(const uint32_t& screenWidth, const uint32_t& screenHeight) : m_surfaceWidth(screenWidth), m_surfaceHeight(screenHeight)
+VulkanManager::VulkanManager(const uint32_t& screenWidth, const uint32_t& screenHeight, bool headless, uint32_t headlessFramesInFlight,
+    const PresentPolicy& presentPolicy) :
+    m_surfaceWidth(screenWidth), m_surfaceHeight(screenHeight), m_presentPolicy(presentPolicy), m_headless(headless), m_headlessFramesInFlight(headlessFramesInFlight)
 {
-    m_validationManagerObj = std::make_unique<ValidationManager>();
+    m_validationManagerObj = std::make_unique<ValidationManager>(headless);
 }
 
 void VulkanManager::Init(GLFWwindow* glfwWindow)
@@ -289,29 +305,41 @@ void VulkanManager::Init(GLFWwindow* glfwWindow)
     CreateInstance();
     AcquirePhysicalDevice();
     m_validationManagerObj->InitDebug(&m_instanceObj, nullptr);
-    m_queueFamilyIndex = GetQueuesFamilyIndex();
-    CreateLogicalDevice(m_queueFamilyIndex);
 
-    vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndex, 0, &m_graphicsQueue);
-    vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndex, 1, &m_computeQueue);
+    // The graphics family has to be able to present, so the surface comes before queue selection
+    if (!m_headless)
+        CreateSurface(glfwWindow);
+
+    m_queueFamilies = GetQueueFamilies();
+    m_queueFamilyIndex = m_queueFamilies.graphics.familyIndex;
+    CreateLogicalDevice();
+
+    vkGetDeviceQueue(m_logicalDevice, m_queueFamilies.graphics.familyIndex, m_queueFamilies.graphics.queueIndex, &m_graphicsQueue);
+    vkGetDeviceQueue(m_logicalDevice, m_queueFamilies.compute.familyIndex, m_queueFamilies.compute.queueIndex, &m_computeQueue);
+    vkGetDeviceQueue(m_logicalDevice, m_queueFamilies.transfer.familyIndex, m_queueFamilies.transfer.queueIndex, &m_transferQueue);
+
+    m_memoryAllocator = std::make_unique<MemoryAllocator>(m_logicalDevice, m_physicalDevice);
+    CreatePipelineCache();
 
     GetMaxUsableVKSampleCount();
     FindBestDepthFormat();
-    CreateSurface(glfwWindow);
-    CreateSwapchain();
-
-    MakeSwapchainImagesPresentable(m_logicalDevice, m_swapchainImageList, m_graphicsQueue, m_queueFamilyIndex);
 
+    if (m_headless)
     {
-        for (uint32_t i = 0; i < m_maxFrameInFlight; i++)
-        {
-            VkSemaphoreCreateInfo semInfo{};
-            semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-            VkSemaphore semaphore = VK_NULL_HANDLE;
-            ErrorCheck(vkCreateSemaphore(m_logicalDevice, &semInfo, nullptr, &semaphore));
-            m_renderingCompletedSignalSemaphore.push_back(semaphore);
-        }
+        CreateOffscreenTargets();
     }
+    else
+    {
+        CreateSwapchain();
+    }
+
+    m_frameCompletions.resize(m_maxFrameInFlight);
+    m_frameLatencies.resize(m_maxFrameInFlight);
+    m_immediateSubmitContext = std::make_unique<ImmediateSubmitContext>(m_logicalDevice, m_graphicsQueue, m_queueFamilyIndex);
+    ChangeImageLayout(m_immediateSubmitContext->Begin(), m_swapchainImageList, VK_IMAGE_LAYOUT_UNDEFINED, m_presentLayout);
+
+    m_gpuProfiler = std::make_unique<GpuProfiler>(m_logicalDevice, m_physicalDevice,
+        std::vector<uint32_t>{ m_queueFamilies.graphics.familyIndex, m_queueFamilies.compute.familyIndex }, m_maxFrameInFlight);
 
     {
         VkCommandPoolCreateInfo createInfo{};
@@ -339,15 +367,30 @@ void VulkanManager::DeInit()
 
 //    vkDestroySemaphore(m_logicalDevice, m_cpuWaitSemaphore, nullptr);
 
-    for (uint32_t i = 0; i < m_maxFrameInFlight; i++)
+    for (auto& semaphore : m_renderingCompletedSignalSemaphore)
     {
-        vkDestroySemaphore(m_logicalDevice, m_renderingCompletedSignalSemaphore[i], nullptr);
+        vkDestroySemaphore(m_logicalDevice, semaphore, nullptr);
     }
 
     vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
 
-    DestroySwapChain();
-    vkDestroySurfaceKHR(m_instanceObj, m_surface, nullptr);
+    if (m_headless)
+    {
+        DestroyOffscreenTargets();
+    }
+    else
+    {
+        ReleaseRetiredSwapchains(true);
+        DestroySwapChain();
+        vkDestroySurfaceKHR(m_instanceObj, m_surface, nullptr);
+    }
+
+    m_immediateSubmitContext.reset();
+    m_gpuProfiler.reset();
+    SaveAndDestroyPipelineCache();
+
+    // Every resource has to be released by now, the blocks go away with the allocator
+    m_memoryAllocator.reset();
     vkDestroyDevice(m_logicalDevice, nullptr);
     m_validationManagerObj->DeinitDebug();
 
@@ -384,6 +427,31 @@ const VkPhysicalDevice & VulkanManager::GetPhysicalDevice() const
     return m_physicalDevice;
 }
 
+MemoryAllocator & VulkanManager::GetMemoryAllocator() const
+{
+    return *m_memoryAllocator;
+}
+
+ImmediateSubmitContext & VulkanManager::GetImmediateSubmitContext() const
+{
+    return *m_immediateSubmitContext;
+}
+
+GpuProfiler & VulkanManager::GetGpuProfiler() const
+{
+    return *m_gpuProfiler;
+}
+
+const VkPipelineCache & VulkanManager::GetPipelineCache() const
+{
+    return m_pipelineCache;
+}
+
+bool VulkanManager::IsPipelineCacheWarm() const
+{
+    return m_pipelineCacheWarm;
+}
+
 uint32_t VulkanManager::GetQueueFamilyIndex() const
 {
     return m_queueFamilyIndex;
@@ -391,13 +459,123 @@ uint32_t VulkanManager::GetQueueFamilyIndex() const
 
 uint32_t VulkanManager::GetActiveSwapchainImageIndex(const VkSemaphore& imageAquiredSignalSemaphore)
 {
+    if (m_headless)
+    {
+        // One offscreen target per frame in flight, the timeline wait on the frame guarantees it is free
+        m_currentSwpachainIndex = m_frameInFlightIndex;
+        return m_currentSwpachainIndex;
+    }
+
+    ReleaseRetiredSwapchains(false);
+
     //Get the swapchain image index
-    ErrorCheck(vkAcquireNextImageKHR(m_logicalDevice, m_swapchainObj, UINT64_MAX,
-        imageAquiredSignalSemaphore, VK_NULL_HANDLE, &m_currentSwpachainIndex));
+    FRAME_STATS_SCOPE(ACQUIRE);
+    m_imageAcquired = false;
+    if (m_swapchainOutOfDate)
+        return UINT32_MAX;
+
+    VkResult result = vkAcquireNextImageKHR(m_logicalDevice, m_swapchainObj, UINT64_MAX,
+        imageAquiredSignalSemaphore, VK_NULL_HANDLE, &m_currentSwpachainIndex);
 
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        // The semaphore is left unsignaled, this frame finishes without presenting
+        m_swapchainOutOfDate = true;
+        return UINT32_MAX;
+    }
+
+    // A suboptimal image is still presentable, use it and recreate afterwards
+    if (result == VK_SUBOPTIMAL_KHR)
+        m_swapchainOutOfDate = true;
+    else
+        ErrorCheck(result);
+
+    m_imageAcquired = true;
     return m_currentSwpachainIndex;
 }
 
+bool VulkanManager::IsSwapchainOutOfDate() const
+{
+    return m_swapchainOutOfDate;
+}
+
+VkExtent2D VulkanManager::GetSurfaceExtent() const
+{
+    return VkExtent2D{ (uint32_t)m_surfaceWidth, (uint32_t)m_surfaceHeight };
+}
+
+bool VulkanManager::RecreateSwapchain()
+{
+    assert(!m_headless);
+
+    ErrorCheck(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physicalDevice, m_surface, &m_surfaceCapabilities));
+    if (m_surfaceCapabilities.currentExtent.width == 0 || m_surfaceCapabilities.currentExtent.height == 0)
+    {
+        m_swapchainOutOfDate = true;
+        return false;
+    }
+
+    // No device wait, the old swapchain is only destroyed once the frames that were in flight have completed.
+    // Frames submitted from now on only reference the new images.
+    RetiredSwapchain retired{};
+    retired.swapchain = m_swapchainObj;
+    retired.imageViews = std::move(m_swapChainImageViewList);
+    for (auto& completion : m_frameCompletions)
+    {
+        if (completion.semaphore != VK_NULL_HANDLE)
+            retired.pendingFrames.push_back(completion);
+    }
+    m_retiredSwapchains.push_back(std::move(retired));
+
+    CreateSwapchain(m_retiredSwapchains.back().swapchain);
+
+    ChangeImageLayout(m_immediateSubmitContext->Begin(), m_swapchainImageList, VK_IMAGE_LAYOUT_UNDEFINED, m_presentLayout);
+    m_immediateSubmitContext->SubmitAndWait();
+
+    m_swapchainOutOfDate = false;
+    return true;
+}
+
+void VulkanManager::ReleaseRetiredSwapchains(bool waitAll)
+{
+    for (auto it = m_retiredSwapchains.begin(); it != m_retiredSwapchains.end();)
+    {
+        bool completed = true;
+        for (auto& frame : it->pendingFrames)
+        {
+            uint64_t value = 0;
+            if (waitAll)
+            {
+                VkSemaphoreWaitInfo waitInfo{};
+                waitInfo.pSemaphores = &frame.semaphore;
+                waitInfo.pValues = &frame.value;
+                waitInfo.semaphoreCount = 1;
+                waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+                ErrorCheck(vkWaitSemaphores(m_logicalDevice, &waitInfo, UINT64_MAX));
+                continue;
+            }
+
+            ErrorCheck(vkGetSemaphoreCounterValue(m_logicalDevice, frame.semaphore, &value));
+            if (value < frame.value)
+            {
+                completed = false;
+                break;
+            }
+        }
+
+        if (!completed)
+        {
+            ++it;
+            continue;
+        }
+
+        for (auto& view : it->imageViews)
+            vkDestroyImageView(m_logicalDevice, view, nullptr);
+        vkDestroySwapchainKHR(m_logicalDevice, it->swapchain, nullptr);
+        it = m_retiredSwapchains.erase(it);
+    }
+}
+
 const VkQueue & VulkanManager::GetComputeQueue() const
 {
     return m_computeQueue;
@@ -408,7 +586,22 @@ const VkQueue & VulkanManager::GetGraphicsQueue() const
     return m_graphicsQueue;
 }
 
-void VulkanManager::CopyAndPresent(const VkImage & srcImage, TimelineSemaphore & semaphore, const VkSemaphore& imageAcquiredSemaphore)
+const VkQueue & VulkanManager::GetTransferQueue() const
+{
+    return m_transferQueue;
+}
+
+uint32_t VulkanManager::GetComputeQueueFamilyIndex() const
+{
+    return m_queueFamilies.compute.familyIndex;
+}
+
+uint32_t VulkanManager::GetTransferQueueFamilyIndex() const
+{
+    return m_queueFamilies.transfer.familyIndex;
+}
+
+void VulkanManager::RecordCopyCommands(const VkImage & srcImage, bool copyToSwapchain)
 {
     // Change layout to tranfer dst, then copy and change it to present layout
     VkCommandBufferBeginInfo beginInfo{};
@@ -416,6 +609,27 @@ void VulkanManager::CopyAndPresent(const VkImage & srcImage, TimelineSemaphore &
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
     ErrorCheck(vkBeginCommandBuffer(m_commandBuffers[m_frameInFlightIndex], &beginInfo));
+    if (!copyToSwapchain)
+    {
+        // Keep the attachment in the layout the graphics task expects at the start of its frame
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.image = srcImage;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        vkCmdPipelineBarrier(m_commandBuffers[m_frameInFlightIndex],
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        ErrorCheck(vkEndCommandBuffer(m_commandBuffers[m_frameInFlightIndex]));
+        return;
+    }
+
+    uint32_t profileScope = m_gpuProfiler->BeginScope(m_commandBuffers[m_frameInFlightIndex], m_frameInFlightIndex, "CopyAndPresent");
 
     std::array<VkImageMemoryBarrier, 2> image_barrier{};
     image_barrier[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -431,7 +645,7 @@ void VulkanManager::CopyAndPresent(const VkImage & srcImage, TimelineSemaphore &
     image_barrier[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     image_barrier[1].image = m_swapchainImageList[m_currentSwpachainIndex];
     image_barrier[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-    image_barrier[1].oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    image_barrier[1].oldLayout = m_presentLayout;
     image_barrier[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 
     // The semaphore takes care of srcStageMask.
@@ -459,17 +673,29 @@ void VulkanManager::CopyAndPresent(const VkImage & srcImage, TimelineSemaphore &
     image_barrier2.image = m_swapchainImageList[m_currentSwpachainIndex];
     image_barrier2.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
     image_barrier2.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    image_barrier2.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    image_barrier2.newLayout = m_presentLayout;
 
     // The semaphore takes care of srcStageMask.
     vkCmdPipelineBarrier(m_commandBuffers[m_frameInFlightIndex],
         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
         0, 0, nullptr, 0, nullptr, 1, &image_barrier2);
 
+    m_gpuProfiler->EndScope(m_commandBuffers[m_frameInFlightIndex], m_frameInFlightIndex, profileScope);
     ErrorCheck(vkEndCommandBuffer(m_commandBuffers[m_frameInFlightIndex]));
+}
+
+void VulkanManager::CopyAndPresent(const VkImage & srcImage, TimelineSemaphore & semaphore, const VkSemaphore& imageAcquiredSemaphore)
+{
+    const bool present = !m_headless && m_imageAcquired;
+    {
+        FRAME_STATS_SCOPE(RECORD);
+        RecordCopyCommands(srcImage, m_headless || present);
+    }
+
+    m_frameCompletions[m_frameInFlightIndex] = { semaphore.GetSemaphore(), semaphore.GetTimelineValue(SAFE_TO_PRESENT) };
 
     VkSemaphoreSubmitInfo signalInfo[2]{
-        {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, m_renderingCompletedSignalSemaphore[m_frameInFlightIndex], 0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0},
+        {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, m_renderingCompletedSignalSemaphore[m_currentSwpachainIndex], 0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0},
         {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, semaphore.GetSemaphore(), semaphore.GetTimelineValue(SAFE_TO_PRESENT), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0}
     };
     
@@ -486,26 +712,176 @@ void VulkanManager::CopyAndPresent(const VkImage & srcImage, TimelineSemaphore &
     VkSubmitInfo2 submitInfo{};
     submitInfo.commandBufferInfoCount = 1;
     submitInfo.pCommandBufferInfos = &cmdInfo;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+
+    if (!present)
+    {
+        // Nothing gets acquired or presented (headless, or the swapchain went out of date), the frame is paced by
+        // the timeline semaphore alone
+        submitInfo.pSignalSemaphoreInfos = &signalInfo[1];
+        submitInfo.pWaitSemaphoreInfos = &waitInfo[0];
+        submitInfo.signalSemaphoreInfoCount = 1;
+        submitInfo.waitSemaphoreInfoCount = 1;
+        {
+            FRAME_STATS_SCOPE(SUBMIT);
+            ErrorCheck(vkQueueSubmit2(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+        }
+
+        m_frameInFlightIndex = (m_frameInFlightIndex + 1) % m_maxFrameInFlight;
+        return;
+    }
+
     submitInfo.pSignalSemaphoreInfos = &signalInfo[0];
     submitInfo.pWaitSemaphoreInfos = &waitInfo[0];
     submitInfo.signalSemaphoreInfoCount = 2;
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
     submitInfo.waitSemaphoreInfoCount = 2;
-    ErrorCheck(vkQueueSubmit2(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+    {
+        FRAME_STATS_SCOPE(SUBMIT);
+        ErrorCheck(vkQueueSubmit2(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+    }
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.pImageIndices = &m_currentSwpachainIndex;
     presentInfo.pSwapchains = &m_swapchainObj;
-    presentInfo.pWaitSemaphores = &m_renderingCompletedSignalSemaphore[m_frameInFlightIndex];
+    presentInfo.pWaitSemaphores = &m_renderingCompletedSignalSemaphore[m_currentSwpachainIndex];
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.swapchainCount = 1;
     presentInfo.waitSemaphoreCount = 1;
 
-    ErrorCheck(vkQueuePresentKHR(m_graphicsQueue, &presentInfo));
+    {
+        FRAME_STATS_SCOPE(PRESENT);
+        VkResult result = vkQueuePresentKHR(m_graphicsQueue, &presentInfo);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+            m_swapchainOutOfDate = true;
+        else
+            ErrorCheck(result);
+        RecordPresentLatency();
+    }
+
+    m_frameInFlightIndex = (m_frameInFlightIndex + 1) % m_maxFrameInFlight;
+}
+
+bool VulkanManager::IsStoragePresentSupported() const
+{
+    return m_storagePresent;
+}
+
+const VkImage & VulkanManager::GetSwapchainImage(uint32_t index) const
+{
+    return m_swapchainImageList[index];
+}
+
+const VkImageView & VulkanManager::GetSwapchainImageView(uint32_t index) const
+{
+    return m_swapChainImageViewList[index];
+}
+
+void VulkanManager::PresentStorageImage(TimelineSemaphore & semaphore)
+{
+    assert(m_storagePresent);
+
+    m_frameCompletions[m_frameInFlightIndex] = { semaphore.GetSemaphore(), semaphore.GetTimelineValue(SAFE_TO_PRESENT) };
+
+    // No command buffer, the submit only converts the timeline value into the binary semaphore present needs
+    VkSemaphoreSubmitInfo signalInfo[2]{
+        {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, m_renderingCompletedSignalSemaphore[m_currentSwpachainIndex], 0, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 0},
+        {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, semaphore.GetSemaphore(), semaphore.GetTimelineValue(SAFE_TO_PRESENT), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 0}
+    };
+
+    VkSemaphoreSubmitInfo waitInfo
+    { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO, nullptr, semaphore.GetSemaphore(), semaphore.GetTimelineValue(COMPUTE_FINISHED), VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 0 };
+
+    VkSubmitInfo2 submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    if (m_imageAcquired)
+    {
+        submitInfo.pSignalSemaphoreInfos = &signalInfo[0];
+        submitInfo.signalSemaphoreInfoCount = 2;
+        submitInfo.pWaitSemaphoreInfos = &waitInfo;
+        submitInfo.waitSemaphoreInfoCount = 1;
+    }
+    else
+    {
+        submitInfo.pSignalSemaphoreInfos = &signalInfo[1];
+        submitInfo.signalSemaphoreInfoCount = 1;
+    }
+
+    {
+        FRAME_STATS_SCOPE(SUBMIT);
+        ErrorCheck(vkQueueSubmit2(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+    }
+
+    if (m_imageAcquired)
+    {
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.pImageIndices = &m_currentSwpachainIndex;
+        presentInfo.pSwapchains = &m_swapchainObj;
+        presentInfo.pWaitSemaphores = &m_renderingCompletedSignalSemaphore[m_currentSwpachainIndex];
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.swapchainCount = 1;
+        presentInfo.waitSemaphoreCount = 1;
+
+        FRAME_STATS_SCOPE(PRESENT);
+        VkResult result = vkQueuePresentKHR(m_graphicsQueue, &presentInfo);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+            m_swapchainOutOfDate = true;
+        else
+            ErrorCheck(result);
+        RecordPresentLatency();
+    }
 
     m_frameInFlightIndex = (m_frameInFlightIndex + 1) % m_maxFrameInFlight;
 }
 
+void VulkanManager::MarkInputSampled(std::chrono::steady_clock::time_point inputSampled)
+{
+    m_frameLatencies[m_frameInFlightIndex] = { inputSampled, false };
+}
+
+void VulkanManager::RecordPresentLatency()
+{
+    FrameLatency& latency = m_frameLatencies[m_frameInFlightIndex];
+    if (latency.inputSampled == std::chrono::steady_clock::time_point{})
+        return;
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - latency.inputSampled).count();
+    m_inputToPresentLatency.Record((uint64_t)us);
+    latency.presented = true;
+}
+
+void VulkanManager::OnFrameCompleted(uint32_t frameInFlight)
+{
+    FrameLatency& latency = m_frameLatencies[frameInFlight];
+    if (!latency.presented)
+        return;
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - latency.inputSampled).count();
+    m_inputToCompletionLatency.Record((uint64_t)us);
+    latency.presented = false;
+}
+
+void VulkanManager::PrintPresentStatistics() const
+{
+    if (m_headless)
+    {
+        std::cout << "Present : headless, " << m_maxFrameInFlight << " frame(s) in flight" << std::endl;
+        return;
+    }
+
+    std::cout << "Present : " << GetPresentPolicyModeName(m_presentPolicy.mode) << " policy, " << GetPresentModeName(m_presentMode)
+        << ", " << m_swapchainImageCount << " images, " << m_maxFrameInFlight << " frame(s) in flight" << std::endl;
+
+    auto PrintLatency = [](const char* name, const LatencyHistogram& histogram)
+    {
+        if (histogram.GetCount() == 0)
+            return;
+        std::cout << "    " << name << " : avg " << histogram.GetAverage() / 1000.0 << " ms, p50 " << histogram.GetPercentile(50.0) / 1000.0
+            << " ms, p99 " << histogram.GetPercentile(99.0) / 1000.0 << " ms (" << histogram.GetCount() << " frames)" << std::endl;
+    };
+    PrintLatency("input -> present queued", m_inputToPresentLatency);
+    PrintLatency("input -> frame completed", m_inputToCompletionLatency);
+}
+
 bool VulkanManager::AreTheQueuesIdle()
 {
     vkQueueWaitIdle(m_computeQueue);
@@ -514,6 +890,11 @@ bool VulkanManager::AreTheQueuesIdle()
     return true;
 }
 
+bool VulkanManager::IsHeadless() const
+{
+    return m_headless;
+}
+
 void VulkanManager::CreateSurface(GLFWwindow * glfwWindow)
 {
 #if defined(GLFW_ENABLED)
@@ -528,14 +909,6 @@ void VulkanManager::CreateSurface(GLFWwindow * glfwWindow)
     std::exit(-1);
 #endif
 
-    VkBool32 WSI_supported = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevice, m_queueFamilyIndex, m_surface, &WSI_supported);
-    if (!WSI_supported)
-    {
-        assert(0);
-        std::exit(-1);
-    }
-
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physicalDevice, m_surface, &m_surfaceCapabilities);
 
     if (m_surfaceCapabilities.currentExtent.width < UINT32_MAX)
@@ -566,36 +939,43 @@ void VulkanManager::CreateSurface(GLFWwindow * glfwWindow)
     }
 }
 
-void VulkanManager::CreateSwapchain()
+void VulkanManager::CreateSwapchain(VkSwapchainKHR oldSwapchain)
 {
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physicalDevice, m_surface, &m_surfaceCapabilities);
 
-    if (m_surfaceCapabilities.maxImageCount > 0)
-        if (m_swapchainImageCount > m_surfaceCapabilities.maxImageCount)
-            m_swapchainImageCount = m_surfaceCapabilities.maxImageCount;
-
-    if (m_swapchainImageCount < m_surfaceCapabilities.minImageCount + 1)
-        m_swapchainImageCount = m_surfaceCapabilities.minImageCount + 1;
+    // 0xFFFFFFFF means the surface takes whatever the swapchain is created with
+    if (m_surfaceCapabilities.currentExtent.width != UINT32_MAX)
+    {
+        m_surfaceWidth = m_surfaceCapabilities.currentExtent.width;
+        m_surfaceHeight = m_surfaceCapabilities.currentExtent.height;
+    }
 
-    auto presentMode = VkPresentModeKHR::VK_PRESENT_MODE_FIFO_KHR;
+    PresentConfiguration config{};
     {
         uint32_t count = 0;
         ErrorCheck(vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &count, nullptr));
         std::vector<VkPresentModeKHR> presentModeList(count);
         ErrorCheck(vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &count, presentModeList.data()));
 
-        for (VkPresentModeKHR obj : presentModeList)
-        {
-            if (obj == VK_PRESENT_MODE_MAILBOX_KHR)
-            {
-                presentMode = obj;
-                m_swapchainImageCount = 3;
-                break;
-            }
-        }
+        config = ResolvePresentPolicy(m_presentPolicy, m_surfaceCapabilities, presentModeList);
     }
+    m_presentMode = config.presentMode;
+    m_swapchainImageCount = config.imageCount;
+
+    // The tasks size their per frame resources with this, it stays what the first swapchain picked
+    if (m_maxFrameInFlight == 0)
+        m_maxFrameInFlight = config.framesInFlight;
+
+    // Decided once with the first swapchain, the frame loop picks its present path from it
+    if (oldSwapchain == VK_NULL_HANDLE)
+    {
+        VkFormatProperties formatProperties{};
+        vkGetPhysicalDeviceFormatProperties(m_physicalDevice, m_surfaceFormat.format, &formatProperties);
 
-    m_maxFrameInFlight = m_swapchainImageCount - 1;
+        m_storagePresent = m_storageWriteWithoutFormat &&
+            (m_surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT) &&
+            (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+    }
 
     VkSwapchainCreateInfoKHR swapChainCreateInfo{};
     swapChainCreateInfo.clipped = VK_TRUE; // dont render parts of swapchain image that are out of the frustrum
@@ -606,13 +986,25 @@ void VulkanManager::CreateSwapchain()
     swapChainCreateInfo.imageExtent.width = m_surfaceWidth;
     swapChainCreateInfo.imageFormat = m_surfaceFormat.format;
     swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    swapChainCreateInfo.queueFamilyIndexCount = 0; // as its not shared between multiple queues
+    swapChainCreateInfo.pQueueFamilyIndices = nullptr;
     swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    if (m_storagePresent)
+        swapChainCreateInfo.imageUsage |= VK_IMAGE_USAGE_STORAGE_BIT;
+
+    // Zero-copy frames are written on the compute queue and presented on the graphics queue. Across families the
+    // images are shared instead of transferring ownership twice per frame.
+    const uint32_t sharingFamilies[2]{ m_queueFamilies.graphics.familyIndex, m_queueFamilies.compute.familyIndex };
+    if (m_storagePresent && sharingFamilies[0] != sharingFamilies[1])
+    {
+        swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+        swapChainCreateInfo.queueFamilyIndexCount = 2;
+        swapChainCreateInfo.pQueueFamilyIndices = sharingFamilies;
+    }
     swapChainCreateInfo.minImageCount = m_swapchainImageCount;
     swapChainCreateInfo.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
-    swapChainCreateInfo.presentMode = presentMode;
-    swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE; // useful when resizing the window
-    swapChainCreateInfo.queueFamilyIndexCount = 0; // as its not shared between multiple queues
-    swapChainCreateInfo.pQueueFamilyIndices = nullptr;
+    swapChainCreateInfo.presentMode = m_presentMode;
+    swapChainCreateInfo.oldSwapchain = oldSwapchain; // lets the driver reuse resources when resizing the window
     swapChainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     swapChainCreateInfo.surface = m_surface;
 
@@ -623,7 +1015,10 @@ void VulkanManager::CreateSwapchain()
     ErrorCheck(vkGetSwapchainImagesKHR(m_logicalDevice, m_swapchainObj, &count, nullptr));
     m_swapchainImageList.resize(count);
     ErrorCheck(vkGetSwapchainImagesKHR(m_logicalDevice, m_swapchainObj, &count, m_swapchainImageList.data()));
-    assert(m_swapchainImageCount == (uint32_t)m_swapchainImageList.size());
+    // minImageCount is a lower bound, the driver is free to create more
+    m_swapchainImageCount = count;
+
+    CreateRenderingCompletedSemaphores();
 
     // swapchain image views
     m_swapChainImageViewList.resize(m_swapchainImageCount);
@@ -645,6 +1040,19 @@ void VulkanManager::CreateSwapchain()
     }
 }
 
+void VulkanManager::CreateRenderingCompletedSemaphores()
+{
+    // Kept across recreation, only grows when the new swapchain has more images
+    while (m_renderingCompletedSignalSemaphore.size() < m_swapchainImageCount)
+    {
+        VkSemaphoreCreateInfo semInfo{};
+        semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        ErrorCheck(vkCreateSemaphore(m_logicalDevice, &semInfo, nullptr, &semaphore));
+        m_renderingCompletedSignalSemaphore.push_back(semaphore);
+    }
+}
+
 void VulkanManager::DestroySwapChain()
 {
     for (auto& view : m_swapChainImageViewList)
@@ -653,3 +1061,159 @@ void VulkanManager::DestroySwapChain()
     }
     vkDestroySwapchainKHR(m_logicalDevice, m_swapchainObj, nullptr);
 }
+
+void VulkanManager::CreateOffscreenTargets()
+{
+    // Mirror what the swapchain path would have produced so the rest of the frame loop stays untouched
+    m_surfaceFormat.format = VK_FORMAT_B8G8R8A8_UNORM;
+    m_surfaceFormat.colorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
+    m_presentLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    m_maxFrameInFlight = m_headlessFramesInFlight;
+    m_swapchainImageCount = m_maxFrameInFlight;
+
+    m_swapChainImageViewList.resize(m_swapchainImageCount);
+    for (uint32_t i = 0; i < m_swapchainImageCount; i++)
+    {
+        auto[image, memory] = CreateImage(m_logicalDevice, *m_memoryAllocator, (uint32_t)m_surfaceWidth, (uint32_t)m_surfaceHeight,
+            m_surfaceFormat.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+        m_swapchainImageList.push_back(image);
+        m_offscreenImageMemoryList.push_back(memory);
+
+        VkImageViewCreateInfo createInfo{};
+        createInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY,VK_COMPONENT_SWIZZLE_IDENTITY };
+        createInfo.format = m_surfaceFormat.format;
+        createInfo.image = m_swapchainImageList[i];
+        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        createInfo.subresourceRange.baseArrayLayer = 0;
+        createInfo.subresourceRange.baseMipLevel = 0;
+        createInfo.subresourceRange.layerCount = 1;
+        createInfo.subresourceRange.levelCount = 1;
+        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+        ErrorCheck(vkCreateImageView(m_logicalDevice, &createInfo, nullptr, &m_swapChainImageViewList[i]));
+    }
+
+    // Never waited on by a present, CopyAndPresent still expects one per image
+    CreateRenderingCompletedSemaphores();
+}
+
+void VulkanManager::DestroyOffscreenTargets()
+{
+    for (uint32_t i = 0; i < m_swapchainImageList.size(); i++)
+    {
+        vkDestroyImageView(m_logicalDevice, m_swapChainImageViewList[i], nullptr);
+        vkDestroyImage(m_logicalDevice, m_swapchainImageList[i], nullptr);
+        m_memoryAllocator->Free(m_offscreenImageMemoryList[i]);
+    }
+    m_swapChainImageViewList.clear();
+    m_swapchainImageList.clear();
+    m_offscreenImageMemoryList.clear();
+}
+
+void VulkanManager::CreatePipelineCache()
+{
+    VkPhysicalDeviceProperties deviceProp{};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProp);
+
+    // Only seed the cache when the file was produced by this exact device + driver
+    std::vector<char> initialData;
+    std::ifstream file(GetPipelineCacheFilePath(), std::ios::binary);
+    if (file.is_open())
+    {
+        PipelineCacheFileHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        // The remaining file length, dataSize is only trusted up to that
+        const std::streampos dataBegin = file.tellg();
+        file.seekg(0, std::ios::end);
+        const std::streamoff remaining = file.good() ? (std::streamoff)(file.tellg() - dataBegin) : 0;
+        file.seekg(dataBegin);
+
+        bool valid = file.good() &&
+            header.dataSize > 0 &&
+            header.dataSize <= (uint64_t)remaining &&
+            header.dataSize <= PIPELINE_CACHE_MAX_SIZE &&
+            header.magic == PIPELINE_CACHE_MAGIC &&
+            header.vendorID == deviceProp.vendorID &&
+            header.deviceID == deviceProp.deviceID &&
+            header.driverVersion == deviceProp.driverVersion &&
+            memcmp(header.pipelineCacheUUID, deviceProp.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+        if (valid)
+        {
+            initialData.resize((size_t)header.dataSize);
+            file.read(initialData.data(), initialData.size());
+            if (!file.good())
+            {
+                initialData.clear();
+            }
+        }
+
+        if (initialData.empty())
+        {
+            std::cout << "Pipeline cache : ignoring stale or corrupt " << GetPipelineCacheFilePath() << std::endl;
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    ErrorCheck(vkCreatePipelineCache(m_logicalDevice, &createInfo, nullptr, &m_pipelineCache));
+    m_pipelineCacheWarm = !initialData.empty();
+}
+
+void VulkanManager::SaveAndDestroyPipelineCache()
+{
+    size_t dataSize = 0;
+    ErrorCheck(vkGetPipelineCacheData(m_logicalDevice, m_pipelineCache, &dataSize, nullptr));
+    std::vector<char> data(dataSize);
+    ErrorCheck(vkGetPipelineCacheData(m_logicalDevice, m_pipelineCache, &dataSize, data.data()));
+
+    vkDestroyPipelineCache(m_logicalDevice, m_pipelineCache, nullptr);
+    m_pipelineCache = VK_NULL_HANDLE;
+
+    VkPhysicalDeviceProperties deviceProp{};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProp);
+
+    PipelineCacheFileHeader header{};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.vendorID = deviceProp.vendorID;
+    header.deviceID = deviceProp.deviceID;
+    header.driverVersion = deviceProp.driverVersion;
+    memcpy(header.pipelineCacheUUID, deviceProp.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = dataSize;
+
+    // Write to a temporary file and rename it over the old one, a crash half way never leaves a truncated cache behind
+    const std::string path = GetPipelineCacheFilePath();
+    const std::string tempPath = path + ".tmp";
+
+    std::error_code errorCode;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), errorCode);
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "Pipeline cache : couldn't open " << tempPath << " for writing" << std::endl;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), data.size());
+        if (!file.good())
+        {
+            std::cout << "Pipeline cache : failed writing " << tempPath << std::endl;
+            return;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, errorCode);
+    if (errorCode)
+    {
+        std::cout << "Pipeline cache : couldn't replace " << path << " (" << errorCode.message() << ")" << std::endl;
+        std::filesystem::remove(tempPath, errorCode);
+    }
+}
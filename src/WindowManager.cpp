@@ -27,6 +27,18 @@ bool WindowManager::Update()
     return windowShouldRun;
 }
 
+bool WindowManager::ConsumeResize()
+{
+    bool resized = m_framebufferResized;
+    m_framebufferResized = false;
+    return resized;
+}
+
+void WindowManager::WaitForEvents()
+{
+    glfwWaitEvents();
+}
+
 void WindowManager::InitOSWindow()
 {
     glfwInit();
@@ -37,6 +49,15 @@ void WindowManager::InitOSWindow()
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindow = glfwCreateWindow(m_screenWidth, m_screenHeight, "Vulkan", nullptr, nullptr);
     glfwGetFramebufferSize(glfwWindow, (int*)&m_screenWidth, (int*)&m_screenHeight);
+
+    glfwSetWindowUserPointer(glfwWindow, this);
+    glfwSetFramebufferSizeCallback(glfwWindow, [](GLFWwindow* window, int width, int height)
+    {
+        auto windowManager = static_cast<WindowManager*>(glfwGetWindowUserPointer(window));
+        windowManager->m_screenWidth = (uint32_t)width;
+        windowManager->m_screenHeight = (uint32_t)height;
+        windowManager->m_framebufferResized = true;
+    });
 }
 
 void WindowManager::DeInitOSWindow()
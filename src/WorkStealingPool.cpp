@@ -0,0 +1,110 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (uint32_t i = 0; i < threadCount; i++)
+        m_ranges.push_back(std::make_unique<TaskRange>());
+    for (uint32_t i = 0; i < threadCount; i++)
+        m_workers.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_batchCondition.notify_all();
+    for (std::thread& worker : m_workers)
+        worker.join();
+}
+
+void WorkStealingPool::WorkerLoop(uint32_t worker)
+{
+    uint64_t lastBatch = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_batchCondition.wait(lock, [&]() { return m_quit || m_batch != lastBatch; });
+        if (m_quit)
+            return;
+        lastBatch = m_batch;
+        lock.unlock();
+
+        uint32_t task = 0;
+        while (TakeOwn(worker, task) || Steal(worker, task))
+            m_task(task, worker);
+
+        lock.lock();
+        if (--m_busyWorkers == 0)
+            m_doneCondition.notify_all();
+    }
+}
+
+bool WorkStealingPool::TakeOwn(uint32_t worker, uint32_t& task)
+{
+    TaskRange& range = *m_ranges[worker];
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if (range.begin == range.end)
+        return false;
+    task = range.begin++;
+    return true;
+}
+
+bool WorkStealingPool::Steal(uint32_t worker, uint32_t& task)
+{
+    const uint32_t workerCount = (uint32_t)m_ranges.size();
+    for (uint32_t i = 1; i < workerCount; i++)
+    {
+        TaskRange& victim = *m_ranges[(worker + i) % workerCount];
+        uint32_t begin = 0, end = 0;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin == victim.end)
+                continue;
+            // Back half, rounded up so a single remaining task can be taken too
+            begin = victim.end - (victim.end - victim.begin + 1) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+
+        // Our own range is empty, nobody steals from it meanwhile
+        TaskRange& own = *m_ranges[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        task = begin;
+        own.begin = begin + 1;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::Run(uint32_t taskCount, const std::function<void(uint32_t task, uint32_t worker)>& task)
+{
+    if (taskCount == 0)
+        return;
+
+    const uint32_t workerCount = (uint32_t)m_ranges.size();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task = task;
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        std::lock_guard<std::mutex> rangeLock(m_ranges[i]->mutex);
+        m_ranges[i]->begin = (uint32_t)((uint64_t)taskCount * i / workerCount);
+        m_ranges[i]->end = (uint32_t)((uint64_t)taskCount * (i + 1) / workerCount);
+    }
+    m_busyWorkers = workerCount;
+    m_batch++;
+    m_batchCondition.notify_all();
+
+    m_doneCondition.wait(lock, [this]() { return m_busyWorkers == 0; });
+}
+
+uint32_t WorkStealingPool::GetThreadCount() const
+{
+    return (uint32_t)m_workers.size();
+}
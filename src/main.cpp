@@ -1,8 +1,17 @@
 #include "VulkanManager.h"
 #include "GraphicsTask.h"
+#include "ComputeTask.h"
+#include "FrameStats.h"
+#include "FrameRing.h"
+#include "KernelAutotuner.h"
 #include <optional>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <cmath>
+#include <assert.h>
 
-int main()
+int main(int argc, char** argv)
 {
     constexpr uint32_t screenWidth = 600;
     constexpr uint32_t screenHeight = 600;
@@ -10,103 +19,265 @@ int main()
     constexpr uint32_t imageWidth = 1024;
     constexpr uint32_t imageHeight = 1024;
 
-    std::unique_ptr<WindowManager> windowManagerObj = std::make_unique<WindowManager>(screenWidth, screenHeight);
-    windowManagerObj->Init();
+    // --headless runs the frame loop against offscreen images for --frames frames, no window / surface / swapchain
+    bool headless = false;
+    uint64_t headlessFrameCount = 1000;
+    // Frame loop phase histograms (ENABLE_FRAME_STATS builds), dumped every --stats-interval frames to stdout or --stats-file (.csv / .json)
+    uint64_t statsInterval = 600;
+    std::string statsFile;
+    // --present-policy default|low-latency|throughput|power-saving, --swapchain-images / --frames-in-flight override it
+    PresentPolicy presentPolicy{};
+    // Workgroup shape / unroll come from CACHE_PATH/autotune.txt, tuned on the first run on a device.
+    // --retune times the variants again, --no-autotune keeps the MandlebrotSettings defaults.
+    bool autotune = true;
+    bool retune = false;
+    // --interior-culling skips the cardioid / bulb and stops cycling orbits, see Mandlebrot.glsl
+    bool interiorCulling = false;
+    // --kernel grid|persistent|mariani-silver, see MandlebrotKernel
+    MandlebrotKernel kernel = MandlebrotKernel::GRID;
+    // The view zooms into --zoom-center by 0.5% a frame and starts over after --zoom-frames frames. Past ~1150
+    // frames the float kernel runs out of precision and the df64 one takes over (ComputeTask::SelectPrecision),
+    // past ~4000 frames the perturbation one. 1e-30 is ~13800 frames in, the center needs that many digits.
+    MandlebrotView zoomTarget{};
+    uint64_t zoomFrames = 1000;
+    // --copy-present keeps the graphics pass + copy even when compute could write the swapchain images directly
+    bool forceCopyPresent = false;
+    // --hybrid renders part of every frame's rows on the CPU, see ComputeTask::SelectGpuRows. The CPU rows go into
+    // the storage image, so this implies --copy-present.
+    bool hybridCpu = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg{ argv[i] };
+        if (arg == "--headless")
+            headless = true;
+        else if (arg == "--frames" && i + 1 < argc)
+            headlessFrameCount = std::stoull(argv[++i]);
+        else if (arg == "--stats-interval" && i + 1 < argc)
+            statsInterval = std::stoull(argv[++i]);
+        else if (arg == "--stats-file" && i + 1 < argc)
+            statsFile = argv[++i];
+        else if (arg == "--copy-present")
+            forceCopyPresent = true;
+        else if (arg == "--hybrid")
+            hybridCpu = forceCopyPresent = true;
+        else if (arg == "--retune")
+            retune = true;
+        else if (arg == "--no-autotune")
+            autotune = false;
+        else if (arg == "--interior-culling")
+            interiorCulling = true;
+        else if (arg == "--kernel" && i + 1 < argc)
+        {
+            if (!ComputeTask::ParseKernel(argv[++i], kernel))
+                std::cout << "Unknown kernel " << argv[i] << ", using grid" << std::endl;
+        }
+        else if (arg == "--zoom-center" && i + 2 < argc)
+        {
+            zoomTarget.preciseCenterX = argv[++i];
+            zoomTarget.preciseCenterY = argv[++i];
+            zoomTarget.centerX = std::stod(zoomTarget.preciseCenterX);
+            zoomTarget.centerY = std::stod(zoomTarget.preciseCenterY);
+        }
+        else if (arg == "--zoom-frames" && i + 1 < argc)
+            zoomFrames = std::max<uint64_t>(std::stoull(argv[++i]), 1);
+        else if (arg == "--present-policy" && i + 1 < argc)
+        {
+            if (!ParsePresentPolicyMode(argv[++i], presentPolicy.mode))
+                std::cout << "Unknown present policy " << argv[i] << ", using default" << std::endl;
+        }
+        else if (arg == "--swapchain-images" && i + 1 < argc)
+            presentPolicy.imageCount = (uint32_t)std::stoul(argv[++i]);
+        else if (arg == "--frames-in-flight" && i + 1 < argc)
+            presentPolicy.framesInFlight = (uint32_t)std::stoul(argv[++i]);
+    }
+
+    std::unique_ptr<WindowManager> windowManagerObj;
+    if (!headless)
+    {
+        windowManagerObj = std::make_unique<WindowManager>(screenWidth, screenHeight);
+        windowManagerObj->Init();
+    }
+
+    auto startupBegin = std::chrono::steady_clock::now();
 
-    std::unique_ptr<VulkanManager> vulkanManager = std::make_unique<VulkanManager>(screenWidth, screenHeight);
-    vulkanManager->Init(windowManagerObj->glfwWindow);
+    std::unique_ptr<VulkanManager> vulkanManager = std::make_unique<VulkanManager>(screenWidth, screenHeight, headless,
+        presentPolicy.framesInFlight > 0 ? presentPolicy.framesInFlight : 2, presentPolicy);
+    vulkanManager->Init(headless ? nullptr : windowManagerObj->glfwWindow);
+
+    auto tasksBegin = std::chrono::steady_clock::now();
+    vulkanManager->PrintPresentStatistics();
 
     uint32_t maxFramesInFlight = vulkanManager->GetMaxFramesInFlight();
-    std::unique_ptr<GraphicsTask> pGraphicsTask = std::make_unique<GraphicsTask>(
-        vulkanManager->GetLogicalDevice(), vulkanManager->GetPhysicalDevice(), vulkanManager->GetGraphicsQueue(),
-        vulkanManager->GetQueueFamilyIndex(), vulkanManager->GetMaxFramesInFlight(),
-        screenWidth, screenHeight);
 
-    std::vector<VkSemaphore> swapchainImageAcquiredSemaphores;
-    for (uint32_t i = 0; i < maxFramesInFlight; i++)
+    MandlebrotSettings settings{};
+    settings.interiorCulling = interiorCulling;
+    settings.kernel = kernel;
+    settings.hybridCpu = hybridCpu;
+    if (autotune)
+        settings = KernelAutotuner(*vulkanManager, imageWidth, imageHeight).LoadOrTune(settings, retune);
+
+    std::unique_ptr<ComputeTask> pComputeTask = std::make_unique<ComputeTask>(
+        vulkanManager->GetLogicalDevice(), vulkanManager->GetMemoryAllocator(), vulkanManager->GetPipelineCache(),
+        vulkanManager->GetGpuProfiler(), vulkanManager->GetImmediateSubmitContext(),
+        vulkanManager->GetComputeQueue(), vulkanManager->GetComputeQueueFamilyIndex(), vulkanManager->GetMaxFramesInFlight(),
+        imageWidth, imageHeight, settings);
+
+    // Zero-copy: Mandlebrot is written straight into the acquired swapchain image, no graphics pass and no copy.
+    // Otherwise the full screen quad renders the compute output into an attachment that gets copied.
+    const bool storagePresent = vulkanManager->IsStoragePresentSupported() && !forceCopyPresent;
+    std::cout << "Present path : " << (storagePresent ? "compute to swapchain (zero-copy)" : "graphics + copy") << std::endl;
+
+    std::unique_ptr<GraphicsTask> pGraphicsTask;
+    if (storagePresent)
+    {
+        pComputeTask->EnableSwapchainTargets(vulkanManager->GetPipelineCache());
+    }
+    else
     {
-        VkSemaphoreCreateInfo info{};
-        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        pGraphicsTask = std::make_unique<GraphicsTask>(
+            vulkanManager->GetLogicalDevice(), vulkanManager->GetMemoryAllocator(), vulkanManager->GetPipelineCache(),
+            vulkanManager->GetGpuProfiler(), vulkanManager->GetImmediateSubmitContext(),
+            vulkanManager->GetGraphicsQueue(), vulkanManager->GetQueueFamilyIndex(), vulkanManager->GetMaxFramesInFlight(),
+            vulkanManager->GetSurfaceExtent().width, vulkanManager->GetSurfaceExtent().height, pComputeTask->GetStorageImageViews());
 
-        VkSemaphore semaphore;
-        ErrorCheck(vkCreateSemaphore(vulkanManager->GetLogicalDevice(), &info, nullptr, &semaphore));
-        swapchainImageAcquiredSemaphores.push_back(semaphore);
+        // Compute written, graphics sampled: with an async compute family the storage images change owner every frame
+        pComputeTask->SetReleaseQueueFamily(vulkanManager->GetQueueFamilyIndex());
+        pGraphicsTask->SetAcquireQueueFamily(pComputeTask->GetQueueFamilyIndex(), pComputeTask->GetStorageImages());
     }
 
-    std::vector<std::unique_ptr<TimelineSemaphore>> timelineSemaphores;
+    // Swapchain, storage image and attachment transitions go out as a single submission
+    vulkanManager->GetImmediateSubmitContext().SubmitAndWait();
+
     {
-        timelineSemaphores.emplace_back(std::make_unique<TimelineSemaphore>(vulkanManager->GetLogicalDevice()));
-        timelineSemaphores.emplace_back(std::make_unique<TimelineSemaphore>(vulkanManager->GetLogicalDevice()));
+        // Task construction is dominated by pipeline creation, which is what the pipeline cache speeds up
+        auto startupEnd = std::chrono::steady_clock::now();
+        std::cout << "Startup (" << (vulkanManager->IsPipelineCacheWarm() ? "warm" : "cold") << " pipeline cache) : "
+            << std::chrono::duration<double, std::milli>(startupEnd - startupBegin).count() << " ms total, "
+            << std::chrono::duration<double, std::milli>(startupEnd - tasksBegin).count() << " ms creating tasks" << std::endl;
     }
 
-    VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
-    {
-        VkSemaphoreCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    vulkanManager->GetMemoryAllocator().PrintStatistics();
 
-        VkSemaphoreTypeCreateInfoKHR typeCreateInfo{};
-        typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
-        typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
-        typeCreateInfo.initialValue = 0;
-        createInfo.pNext = &typeCreateInfo;
+    // Timeline + acquire semaphore per frame in flight, the depth comes from the present policy
+    std::unique_ptr<FrameRing> frameRing = std::make_unique<FrameRing>(vulkanManager->GetLogicalDevice(), maxFramesInFlight);
 
-        ErrorCheck(vkCreateSemaphore(vulkanManager->GetLogicalDevice(), &createInfo, nullptr, &timelineSemaphore));
-    }
+    FRAME_STATS_CONFIGURE(statsInterval, statsFile);
 
-    uint64_t frameIndex = 0;
-    while (windowManagerObj->Update())
+    auto KeepRunning = [&]()
     {
-        auto currentFrameInFlight = vulkanManager->GetFrameInFlightIndex();
-        if (timelineSemaphores[currentFrameInFlight]->GetFrameIndex() > 0)
-        {
-            // wait for previous frame's (corresponding frameInFlight) presentation to complete
-            // this acts as a fence
+        if (headless)
+            return frameRing->GetFrameIndex() < headlessFrameCount;
+        return windowManagerObj->Update();
+    };
 
-            uint64_t value = (timelineSemaphores[currentFrameInFlight]->GetFrameIndex() - 1) * (TimelineStages::NUM_STAGES - 1) + TimelineStages::SAFE_TO_PRESENT;
+    auto startTime = std::chrono::steady_clock::now();
+    while (KeepRunning())
+    {
+        // Input was just polled, the frame's latency runs from here to its present
+        auto inputSampled = std::chrono::steady_clock::now();
 
-            VkSemaphoreWaitInfo waitInfo{};
-            waitInfo.pSemaphores = &timelineSemaphores[currentFrameInFlight]->GetSemaphore();
-            waitInfo.pValues = &value;
-            waitInfo.semaphoreCount = 1;
-            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        // Window resized or the last acquire / present reported the swapchain out of date
+        if (!headless && (windowManagerObj->ConsumeResize() || vulkanManager->IsSwapchainOutOfDate()))
+        {
+            if (!vulkanManager->RecreateSwapchain())
+            {
+                // Minimized, nothing to present to until the window comes back
+                windowManagerObj->WaitForEvents();
+                continue;
+            }
 
-            ErrorCheck(vkWaitSemaphores(vulkanManager->GetLogicalDevice(), &waitInfo, UINT64_MAX));
+            // The zero-copy path picks up the new images and extent on its own every frame
+            VkExtent2D extent = vulkanManager->GetSurfaceExtent();
+            if (pGraphicsTask)
+                pGraphicsTask->Resize(extent.width, extent.height);
         }
 
-        // Trigger graphics tasks
+        // Waits for the previous frame of this slot to be presented, this acts as a fence
+        FrameRing::Frame frame = frameRing->BeginFrame();
+        assert(frame.slot == vulkanManager->GetFrameInFlightIndex());
+        if (frame.slotRetired)
         {
-            uint64_t signalValue = timelineSemaphores[currentFrameInFlight]->GetTimelineValue(TimelineStages::GRAPHICS_FINISHED);
-            uint64_t waitValue = timelineSemaphores[currentFrameInFlight]->GetTimelineValue(TimelineStages::COMPUTE_FINISHED);
-            pGraphicsTask->Update(frameIndex, currentFrameInFlight, timelineSemaphores[currentFrameInFlight]->GetSemaphore(), signalValue, waitValue);
+            // Everything recorded for this frame in flight has completed, its timestamps are ready
+            vulkanManager->GetGpuProfiler().Collect(frame.slot);
+            vulkanManager->OnFrameCompleted(frame.slot);
         }
+        vulkanManager->MarkInputSampled(inputSampled);
 
-        // Get the active swapchain index
-        uint32_t activeSwapchainImageindex = vulkanManager->GetActiveSwapchainImageIndex(swapchainImageAcquiredSemaphores[currentFrameInFlight]);
+        // Slowly zoom in and start over
+        MandlebrotView view = zoomTarget;
+        view.zoom = std::pow(0.995, (double)(frame.index % zoomFrames));
 
-        // End the frame (increments index counters)
-        vulkanManager->CopyAndPresent(pGraphicsTask->GetColorAttachments()[currentFrameInFlight], *timelineSemaphores[currentFrameInFlight], swapchainImageAcquiredSemaphores[currentFrameInFlight]);
+        if (storagePresent)
+        {
+            // Acquire first, the compute dispatch is what writes the image
+            uint32_t imageIndex = vulkanManager->GetActiveSwapchainImageIndex(frame.imageAcquiredSemaphore);
+            if (imageIndex != UINT32_MAX)
+            {
+                uint64_t signalValue = frame.timeline.GetTimelineValue(TimelineStages::COMPUTE_FINISHED);
+                pComputeTask->UpdateSwapchainTarget(frame.slot,
+                    vulkanManager->GetSwapchainImage(imageIndex), vulkanManager->GetSwapchainImageView(imageIndex), vulkanManager->GetSurfaceExtent(),
+                    frame.imageAcquiredSemaphore, frame.timeline.GetSemaphore(), signalValue, view);
+            }
 
-        frameIndex++;
-        timelineSemaphores[currentFrameInFlight]->IncrementFrameIndex();
+            vulkanManager->PresentStorageImage(frame.timeline);
+        }
+        else
+        {
+            // Trigger compute tasks, runs on the compute queue and overlaps the graphics / present work of the previous frame
+            {
+                uint64_t signalValue = frame.timeline.GetTimelineValue(TimelineStages::COMPUTE_FINISHED);
+                pComputeTask->Update(frame.index, frame.slot, frame.timeline.GetSemaphore(), signalValue, view);
+            }
+
+            // Trigger graphics tasks
+            {
+                uint64_t signalValue = frame.timeline.GetTimelineValue(TimelineStages::GRAPHICS_FINISHED);
+                uint64_t waitValue = frame.timeline.GetTimelineValue(TimelineStages::COMPUTE_FINISHED);
+                pGraphicsTask->Update(frame.slot, frame.timeline.GetSemaphore(), signalValue, waitValue);
+            }
+
+            // Get the active swapchain index, when the swapchain is out of date the frame completes without presenting
+            vulkanManager->GetActiveSwapchainImageIndex(frame.imageAcquiredSemaphore);
+
+            // Signals SAFE_TO_PRESENT and advances the manager's frame in flight
+            vulkanManager->CopyAndPresent(pGraphicsTask->GetColorAttachments()[frame.slot], frame.timeline, frame.imageAcquiredSemaphore);
+        }
+
+        frameRing->EndFrame();
+        FRAME_STATS_END_FRAME();
     }
 
     if (vulkanManager->AreTheQueuesIdle())
     {
-        vkDestroySemaphore(vulkanManager->GetLogicalDevice(), timelineSemaphore, nullptr);
+        const uint64_t frameCount = frameRing->GetFrameIndex();
+        if (headless)
+        {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+            std::cout << "Headless: " << frameCount << " frames in " << elapsed.count() << " ms ("
+                << (frameCount * 1000.0 / elapsed.count()) << " fps)" << std::endl;
+        }
 
-        for(auto& sem : swapchainImageAcquiredSemaphores)
-            vkDestroySemaphore(vulkanManager->GetLogicalDevice(), sem, nullptr);
+        for (uint32_t i = 0; i < maxFramesInFlight; i++)
+            vulkanManager->GetGpuProfiler().Collect(i);
+        vulkanManager->GetGpuProfiler().PrintStatistics();
+        for (uint32_t i = 0; i < maxFramesInFlight; i++)
+            vulkanManager->OnFrameCompleted(i);
+        vulkanManager->PrintPresentStatistics();
+        if (pGraphicsTask)
+            std::cout << "Graphics command buffer recordings : " << pGraphicsTask->GetRecordCount() << " over " << frameCount << " frames" << std::endl;
 
-        for (auto& sem : timelineSemaphores)
-            sem.reset();
-        timelineSemaphores.clear();
+        frameRing.reset();
 
         pGraphicsTask.reset();
         pGraphicsTask = nullptr;
+
+        pComputeTask.reset();
+        pComputeTask = nullptr;
     }
 
     vulkanManager->DeInit();
-    windowManagerObj->DeInit();
+    if (windowManagerObj)
+        windowManagerObj->DeInit();
 
     return 0;
 }
\ No newline at end of file